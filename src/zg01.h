@@ -27,6 +27,23 @@
 
 #include "zg01_pcm.h"
 #include "zg01_control.h"
+#include "zg01_shared.h"
+
+/*
+ * Streaming geometry of one interface, as its descriptors report it
+ * (filled in by zg01_discover_usb_config). endpoint = 0 means discovery
+ * found nothing and the ZG01_EP_* / ISO_PKT_SIZE_* defaults apply.
+ */
+struct zg01_stream_desc {
+    u8 endpoint;            /* Isochronous endpoint at alt 1 */
+    bool in;
+    u16 max_packet;         /* wMaxPacketSize, bytes per transaction */
+    u8 interval;            /* bInterval */
+    u8 int_endpoint;        /* Interrupt endpoint of the interface (0 = none) */
+    u8 int_alt;             /* Alt setting carrying it */
+    u16 int_max_packet;
+    u8 int_interval;
+};
 
 /* Multi-URB streaming for stable isochronous transfers */
 #define MAX_URBS_PER_CHANNEL 16   /* Optimal buffering: 64ms reduces clicks to ~2.17% */
@@ -36,6 +53,9 @@ struct zg01_dev {
     struct snd_card *card;
     struct usb_interface *interface;
     int card_index;
+    int pcm_device;               /* PCM device number on the card (single-card topology: 0-2) */
+    struct zg01_shared *shared;   /* Per-USB-device context shared by all cards */
+    struct zg01_stream_desc stream; /* Endpoint geometry from discovery */
 
     struct zg01_midi *midi;
     struct zg01_pcm pcm;
@@ -77,14 +97,26 @@ struct zg01_dev {
     bool game_channel_active;
     bool voice_channel_active;
     bool voice_out_channel_active;
-    bool game_initialized;        /* Track if game channel has been initialized */
-    bool voice_initialized;       /* Track if voice channel has been initialized */
-    bool voice_out_initialized;   /* Track if voice output channel has been initialized */
+    bool iface_claimed;           /* Holds a streaming interface claim in the shared context */
+    bool armed;                   /* Counted as armed in the shared context */
+    bool preroll_armed;           /* Voice In URBs kept running for the capture pre-roll */
+    bool preroll_suspended;       /* Pre-roll stopped for a USB suspend, restart at resume */
+    struct work_struct preroll_work; /* Starts the pre-roll after bring-up, off the probe path */
+    unsigned int rate_list[ZG01_MAX_RATES]; /* Rates offered by the open stream's hw rule */
+    unsigned int nr_rates;
+    int link_frame;               /* Bus frame (1 ms) link time is counted from, -1 until an URB completes. Under lock */
+    unsigned int link_ms;         /* Link time at link_frame since the stream started. Under lock */
+
+    /* Echo reference capture substream on the Game / Voice Out PCM. Under lock. */
+    struct snd_pcm_substream *echo_substream;
+    bool echo_running;
+    unsigned int echo_pos;        /* Frames delivered to the echo ring */
+    int echo_link_frame;          /* Link clock of the echo reference, as link_frame/link_ms */
+    unsigned int echo_link_ms;
     unsigned long game_startup_frames; /* Count frames during startup to allow buffer fill */
     unsigned long voice_startup_frames;
     unsigned long voice_out_startup_frames;
     
-    unsigned int current_rate;      /* Current sample rate (44100 or 48000) */
     unsigned int rate_residual;     /* Fractional sample accumulator */
     
     bool cleanup_in_progress_game;
@@ -112,11 +144,26 @@ struct zg01_dev {
     bool start_pending_voice_out;
 };
 
+/* Streaming interface used by a channel: Game and Voice Out share interface 1 */
+static inline int zg01_channel_iface(struct zg01_dev *dev)
+{
+    return dev->channel_type == CHANNEL_TYPE_VOICE_IN ? 2 : 1;
+}
+
 int zg01_create_pcm(struct zg01_dev *dev);
+void zg01_preroll_start(struct zg01_dev *dev);
+void zg01_free_pcm(struct zg01_dev *dev);
+void zg01_pcm_suspend(struct zg01_dev *dev);
+void zg01_pcm_resume(struct zg01_dev *dev);
 int zg01_set_streaming_interface(struct zg01_dev *dev, int interface, int alt_setting);
 
+/* MIDI (interface 3), on the Game card */
+int zg01_create_midi(struct zg01_dev *dev, struct usb_driver *driver);
+void zg01_free_midi(struct zg01_dev *dev);
+void zg01_midi_suspend(struct zg01_dev *dev);
+void zg01_midi_resume(struct zg01_dev *dev);
+
 /* USB Hardware Discovery Functions */
 int zg01_discover_usb_config(struct zg01_dev *dev);
-int zg01_find_audio_endpoint(struct zg01_dev *dev, u8 *endpoint_addr, u8 *alt_setting);
 
 #endif /* ZG01_H */
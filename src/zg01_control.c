@@ -6,16 +6,36 @@
 
 #include <linux/slab.h>
 #include <linux/interrupt.h>
+#include <linux/jiffies.h>
+#include <linux/math64.h>
+#include <linux/uaccess.h>
 #include <sound/control.h>
 #include <sound/tlv.h>
 
 #include "zg01.h"
 #include "zg01_control.h"
 
+static unsigned int meter_notify_ms;
+module_param(meter_notify_ms, uint, 0644);
+MODULE_PARM_DESC(meter_notify_ms, "Minimum interval between level meter change events in ms (0 = no events)");
+
+static int vad_threshold_db = -45;
+module_param(vad_threshold_db, int, 0644);
+MODULE_PARM_DESC(vad_threshold_db, "Voice activity onset level in dBFS (-59..0)");
+
+static unsigned int vad_hangover_ms = 300;
+module_param(vad_hangover_ms, uint, 0644);
+MODULE_PARM_DESC(vad_hangover_ms, "Time voice activity stays raised after speech ends in ms");
+
 int zg01_init_control(struct zg01_dev *dev)
 {
+    u8 reply[3];
+    /* Device initialization sequence based on USB capture */
+    struct zg01_ctrl_step init_steps[] = {
+        /* Vendor-specific control request - appears to be device initialization */
+        ZG01_CTRL_VENDOR_IN(7, 0x0000, 3),  /* expect 3 bytes response (80bb00) */
+    };
     int ret;
-    unsigned char *buf;
     
     if (!dev || !dev->udev || !dev->interface) {
         return -ENODEV;
@@ -28,47 +48,761 @@ int zg01_init_control(struct zg01_dev *dev)
         return 0;
     }
 
-    /* Allocate DMA-coherent buffer for USB control message */
-    buf = kmalloc(256, GFP_KERNEL);
-    if (!buf) {
-        pr_err("zg01_control: Failed to allocate control buffer\n");
-        return -ENOMEM;
-    }
-
-    /* Device initialization sequence based on USB capture */
     pr_info("zg01_control: Initializing Yamaha ZG01 device\n");
 
-    /* Vendor-specific control request - appears to be device initialization */
-    ret = usb_control_msg(dev->udev, 
-                         usb_rcvctrlpipe(dev->udev, 0), 
-                         7,      /* bRequest */
-                         0xc0,   /* bmRequestType: vendor, device-to-host */
-                         0x0000, /* wValue */
-                         0,      /* wIndex */ 
-                         buf, 3, /* expect 3 bytes response (80bb00) */
-                         1000);
+    init_steps[0].data = reply;
+    ret = zg01_ctrl_run(dev->udev, init_steps, ARRAY_SIZE(init_steps));
+    if (ret == -ENOMEM)
+        return ret;
+
+    ret = init_steps[0].status;
     if (ret < 0) {
         pr_err("zg01_control: ZG01 initialization request failed: %d\n", ret);
-        kfree(buf);
         return ret;
     } else if (ret == 3) {
         pr_info("zg01_control: ZG01 init response: %02x%02x%02x\n", 
-                buf[0], buf[1], buf[2]);
+                reply[0], reply[1], reply[2]);
         /* Expected response should be 0x80, 0xbb, 0x00 */
-        if (buf[0] == 0x80 && buf[1] == 0xbb && buf[2] == 0x00) {
+        if (reply[0] == 0x80 && reply[1] == 0xbb && reply[2] == 0x00) {
             pr_info("zg01_control: ZG01 initialization successful\n");
         } else {
             pr_warn("zg01_control: Unexpected ZG01 init response\n");
         }
     }
 
-    kfree(buf);
-
     return 0;
 }
 
 EXPORT_SYMBOL_GPL(zg01_init_control);
 
+/*
+ * Push control writes still waiting in the write-behind cache out before
+ * the card goes away (driver unbind; after an unplug they just fail).
+ */
+void zg01_free_control(struct zg01_dev *dev)
+{
+    if (dev && dev->channel_type == CHANNEL_TYPE_VOICE_IN)
+        flush_delayed_work(&dev->shared->hwctl.flush);
+}
+
+EXPORT_SYMBOL_GPL(zg01_free_control);
+
+/*
+ * Compile the slot masks into a per-slot source so the packer only has to
+ * look up one entry per slot. The default layout keeps the packer on its
+ * fixed fast path. If both channels claim a slot, left wins.
+ */
+static void zg01_route_compile(struct zg01_control *ctl)
+{
+    int slot;
+
+    for (slot = 0; slot < ZG01_FRAME_SLOTS; slot++) {
+        if (ctl->route_mask[0] & (1 << slot))
+            ctl->route_src[slot] = 0;
+        else if (ctl->route_mask[1] & (1 << slot))
+            ctl->route_src[slot] = 1;
+        else
+            ctl->route_src[slot] = -1;
+    }
+    ctl->route_default = ctl->route_mask[0] == ZG01_ROUTE_DEFAULT_L &&
+                         ctl->route_mask[1] == ZG01_ROUTE_DEFAULT_R;
+}
+
+static int zg01_route_info(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_info *uinfo)
+{
+    uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+    uinfo->count = 2;
+    uinfo->value.integer.min = 0;
+    uinfo->value.integer.max = (1 << ZG01_FRAME_SLOTS) - 1;
+    return 0;
+}
+
+static int zg01_route_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    ucontrol->value.integer.value[0] = dev->control.route_mask[0];
+    ucontrol->value.integer.value[1] = dev->control.route_mask[1];
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static int zg01_route_put(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    long l = ucontrol->value.integer.value[0];
+    long r = ucontrol->value.integer.value[1];
+    unsigned long flags;
+    int changed;
+
+    if (l < 0 || l >= (1 << ZG01_FRAME_SLOTS) || r < 0 || r >= (1 << ZG01_FRAME_SLOTS))
+        return -EINVAL;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    changed = dev->control.route_mask[0] != l || dev->control.route_mask[1] != r;
+    if (changed) {
+        dev->control.route_mask[0] = l;
+        dev->control.route_mask[1] = r;
+        zg01_route_compile(&dev->control);
+    }
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return changed;
+}
+
+/* Q8.24 gain per volume step: 10^((step * 0.5 - 60) / 20), step 0 = mute */
+static const u32 zg01_gain_table[ZG01_VOLUME_MAX + 1] = {
+    0, 17771, 18824, 19940, 21121, 22373, 23698, 25103,
+    26590, 28166, 29835, 31602, 33475, 35458, 37560, 39785,
+    42142, 44640, 47285, 50086, 53054, 56198, 59528, 63055,
+    66791, 70749, 74941, 79382, 84085, 89068, 94345, 99936,
+    105857, 112130, 118774, 125811, 133266, 141163, 149527, 158387,
+    167772, 177713, 188243, 199398, 211213, 223728, 236984, 251027,
+    265901, 281657, 298346, 316024, 334749, 354585, 375595, 397850,
+    421425, 446396, 472846, 500864, 530542, 561979, 595278, 630551,
+    667913, 707489, 749411, 793816, 840853, 890676, 943452, 999355,
+    1058571, 1121295, 1187736, 1258114, 1332662, 1411627, 1495271, 1583871,
+    1677722, 1777133, 1882435, 1993976, 2112126, 2237278, 2369845, 2510267,
+    2659010, 2816566, 2983458, 3160239, 3347495, 3545846, 3755951, 3978505,
+    4214246, 4463956, 4728462, 5008641, 5305422, 5619788, 5952781, 6305505,
+    6679130, 7074893, 7494107, 7938161, 8408526, 8906763, 9434522, 9993552,
+    10585708, 11212950, 11877359, 12581137, 13326616, 14116268, 14952709, 15838713,
+    16777216,
+};
+
+static const DECLARE_TLV_DB_SCALE(zg01_volume_tlv, -6000, 50, 1);
+
+static void zg01_volume_update(struct zg01_control *ctl)
+{
+    int ch;
+
+    for (ch = 0; ch < 2; ch++)
+        ctl->gain_target[ch] = ctl->volume_switch[ch] ? zg01_gain_table[ctl->volume[ch]] : 0;
+}
+
+static int zg01_volume_info(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_info *uinfo)
+{
+    uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+    uinfo->count = 2;
+    uinfo->value.integer.min = 0;
+    uinfo->value.integer.max = ZG01_VOLUME_MAX;
+    return 0;
+}
+
+static int zg01_volume_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    ucontrol->value.integer.value[0] = dev->control.volume[0];
+    ucontrol->value.integer.value[1] = dev->control.volume[1];
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static int zg01_volume_put(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    long l = ucontrol->value.integer.value[0];
+    long r = ucontrol->value.integer.value[1];
+    unsigned long flags;
+    int changed;
+
+    if (l < 0 || l > ZG01_VOLUME_MAX || r < 0 || r > ZG01_VOLUME_MAX)
+        return -EINVAL;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    changed = dev->control.volume[0] != l || dev->control.volume[1] != r;
+    dev->control.volume[0] = l;
+    dev->control.volume[1] = r;
+    zg01_volume_update(&dev->control);
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return changed;
+}
+
+static int zg01_switch_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    ucontrol->value.integer.value[0] = dev->control.volume_switch[0];
+    ucontrol->value.integer.value[1] = dev->control.volume_switch[1];
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static int zg01_switch_put(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    bool l = !!ucontrol->value.integer.value[0];
+    bool r = !!ucontrol->value.integer.value[1];
+    unsigned long flags;
+    int changed;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    changed = dev->control.volume_switch[0] != l || dev->control.volume_switch[1] != r;
+    dev->control.volume_switch[0] = l;
+    dev->control.volume_switch[1] = r;
+    zg01_volume_update(&dev->control);
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return changed;
+}
+
+static int zg01_volume_mono_info(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_info *uinfo)
+{
+    uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+    uinfo->count = 1;
+    uinfo->value.integer.min = 0;
+    uinfo->value.integer.max = ZG01_VOLUME_MAX;
+    return 0;
+}
+
+static int zg01_sidetone_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    ucontrol->value.integer.value[0] = dev->control.sidetone_volume;
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static int zg01_sidetone_put(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    long vol = ucontrol->value.integer.value[0];
+    unsigned long flags;
+    int changed;
+
+    if (vol < 0 || vol > ZG01_VOLUME_MAX)
+        return -EINVAL;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    changed = dev->control.sidetone_volume != vol;
+    dev->control.sidetone_volume = vol;
+    dev->control.sidetone_gain = zg01_gain_table[vol];
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return changed;
+}
+
+/* Mic level mixed into this playback stream; the bottom step switches sidetone off */
+static const struct snd_kcontrol_new zg01_sidetone_ctl = {
+    .iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+    .name = "Sidetone Playback Volume",
+    .access = SNDRV_CTL_ELEM_ACCESS_READWRITE | SNDRV_CTL_ELEM_ACCESS_TLV_READ,
+    .info = zg01_volume_mono_info,
+    .get = zg01_sidetone_get,
+    .put = zg01_sidetone_put,
+    .tlv = { .p = zg01_volume_tlv },
+};
+
+/* Stream mix source gains live in the shared context; private_value is the CHANNEL_TYPE_* source */
+static int zg01_mix_volume_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    struct zg01_mix *mix = &dev->shared->mix;
+    unsigned long flags;
+
+    spin_lock_irqsave(&mix->lock, flags);
+    ucontrol->value.integer.value[0] = mix->volume[kcontrol->private_value];
+    spin_unlock_irqrestore(&mix->lock, flags);
+    return 0;
+}
+
+static int zg01_mix_volume_put(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    struct zg01_mix *mix = &dev->shared->mix;
+    long vol = ucontrol->value.integer.value[0];
+    int src = kcontrol->private_value;
+    unsigned long flags;
+    int changed;
+
+    if (vol < 0 || vol > ZG01_VOLUME_MAX)
+        return -EINVAL;
+
+    spin_lock_irqsave(&mix->lock, flags);
+    changed = mix->volume[src] != vol;
+    mix->volume[src] = vol;
+    mix->gain[src] = zg01_gain_table[vol];
+    spin_unlock_irqrestore(&mix->lock, flags);
+    return changed;
+}
+
+#define ZG01_MIX_VOLUME(xname, src) { \
+    .iface = SNDRV_CTL_ELEM_IFACE_MIXER, \
+    .name = xname, \
+    .access = SNDRV_CTL_ELEM_ACCESS_READWRITE | SNDRV_CTL_ELEM_ACCESS_TLV_READ, \
+    .info = zg01_volume_mono_info, \
+    .get = zg01_mix_volume_get, \
+    .put = zg01_mix_volume_put, \
+    .tlv = { .p = zg01_volume_tlv }, \
+    .private_value = src, \
+}
+
+static const struct snd_kcontrol_new zg01_mix_ctls[] = {
+    ZG01_MIX_VOLUME("Stream Mix Game Capture Volume", CHANNEL_TYPE_GAME),
+    ZG01_MIX_VOLUME("Stream Mix Voice Out Capture Volume", CHANNEL_TYPE_VOICE_OUT),
+    ZG01_MIX_VOLUME("Stream Mix Mic Capture Volume", CHANNEL_TYPE_VOICE_IN),
+};
+
+static const struct snd_kcontrol_new zg01_volume_ctl = {
+    .iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+    .name = "PCM Playback Volume",
+    .access = SNDRV_CTL_ELEM_ACCESS_READWRITE | SNDRV_CTL_ELEM_ACCESS_TLV_READ,
+    .info = zg01_volume_info,
+    .get = zg01_volume_get,
+    .put = zg01_volume_put,
+    .tlv = { .p = zg01_volume_tlv },
+};
+
+static const struct snd_kcontrol_new zg01_switch_ctl = {
+    .iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+    .name = "PCM Playback Switch",
+    .access = SNDRV_CTL_ELEM_ACCESS_READWRITE,
+    .info = snd_ctl_boolean_stereo_info,
+    .get = zg01_switch_get,
+    .put = zg01_switch_put,
+};
+
+/*
+ * Level meters. The streaming callback accumulates peak and sum of squares
+ * while it packs or unpacks an URB and publishes them here; the square root
+ * is only taken when user space reads the RMS control.
+ */
+void zg01_meter_publish(struct zg01_dev *dev, const u32 *peak, const u64 *sumsq,
+                        unsigned int frames)
+{
+    struct zg01_control *ctl = &dev->control;
+    unsigned long flags;
+    bool notify = false;
+    int ch;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    for (ch = 0; ch < 2; ch++) {
+        ctl->meter_peak[ch] = peak[ch];
+        ctl->meter_meansq[ch] = div_u64(sumsq[ch], frames);
+    }
+    if (meter_notify_ms && ctl->meter_peak_kctl &&
+        time_after_eq(jiffies, ctl->meter_notify_next)) {
+        ctl->meter_notify_next = jiffies + msecs_to_jiffies(meter_notify_ms);
+        notify = true;
+    }
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    if (notify) {
+        snd_ctl_notify(dev->card, SNDRV_CTL_EVENT_MASK_VALUE, &ctl->meter_peak_kctl->id);
+        snd_ctl_notify(dev->card, SNDRV_CTL_EVENT_MASK_VALUE, &ctl->meter_rms_kctl->id);
+    }
+}
+
+EXPORT_SYMBOL_GPL(zg01_meter_publish);
+
+static int zg01_meter_info(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_info *uinfo)
+{
+    uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+    uinfo->count = 2;
+    uinfo->value.integer.min = 0;
+    uinfo->value.integer.max = S32_MAX;
+    return 0;
+}
+
+static int zg01_meter_peak_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    unsigned long flags;
+    int ch;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    for (ch = 0; ch < 2; ch++)
+        ucontrol->value.integer.value[ch] = min_t(u32, dev->control.meter_peak[ch], S32_MAX);
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static int zg01_meter_rms_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    u64 meansq[2];
+    unsigned long flags;
+    int ch;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    meansq[0] = dev->control.meter_meansq[0];
+    meansq[1] = dev->control.meter_meansq[1];
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    for (ch = 0; ch < 2; ch++)
+        ucontrol->value.integer.value[ch] = min_t(u64, int_sqrt64(meansq[ch]) << 16, S32_MAX);
+    return 0;
+}
+
+static const struct snd_kcontrol_new zg01_meter_peak_ctl = {
+    .iface = SNDRV_CTL_ELEM_IFACE_PCM,
+    .name = "Level Meter Peak",
+    .access = SNDRV_CTL_ELEM_ACCESS_READ | SNDRV_CTL_ELEM_ACCESS_VOLATILE,
+    .info = zg01_meter_info,
+    .get = zg01_meter_peak_get,
+};
+
+static const struct snd_kcontrol_new zg01_meter_rms_ctl = {
+    .iface = SNDRV_CTL_ELEM_IFACE_PCM,
+    .name = "Level Meter RMS",
+    .access = SNDRV_CTL_ELEM_ACCESS_READ | SNDRV_CTL_ELEM_ACCESS_VOLATILE,
+    .info = zg01_meter_info,
+    .get = zg01_meter_rms_get,
+};
+
+/*
+ * Voice activity of the Voice In stream, decided once per URB from the
+ * unpacker's sums: onset needs the level above vad_threshold_db with a
+ * zero-crossing rate below 1/4 (rejects hiss), and activity holds while
+ * the level stays within 6 dB of the threshold, plus vad_hangover_ms at
+ * the stream's @rate. frames = 0 drops the flag (stream stopped).
+ */
+void zg01_vad_publish(struct zg01_dev *dev, const u64 *sumsq, unsigned int crossings,
+                      unsigned int frames, unsigned int rate)
+{
+    struct zg01_control *ctl = &dev->control;
+    unsigned long flags;
+    bool active, changed;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    if (frames) {
+        int db = clamp(vad_threshold_db, -59, 0);
+        u64 amp = (32768ULL * zg01_gain_table[ZG01_VOLUME_MAX + 2 * db]) >> ZG01_GAIN_SHIFT;
+        u64 level = div_u64(max(sumsq[0], sumsq[1]), frames);
+
+        active = (level >= amp * amp && crossings * 4 < frames) ||
+                 (ctl->vad_active && level >= amp * amp / 4);
+        if (active)
+            ctl->vad_hang = div_u64((u64)vad_hangover_ms * rate, 1000);
+        else
+            ctl->vad_hang -= min(ctl->vad_hang, frames);
+        active = active || ctl->vad_hang > 0;
+    } else {
+        ctl->vad_hang = 0;
+        active = false;
+    }
+    changed = active != ctl->vad_active;
+    ctl->vad_active = active;
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    if (changed && ctl->vad_kctl)
+        snd_ctl_notify(dev->card, SNDRV_CTL_EVENT_MASK_VALUE, &ctl->vad_kctl->id);
+}
+
+EXPORT_SYMBOL_GPL(zg01_vad_publish);
+
+static int zg01_vad_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    ucontrol->value.integer.value[0] = dev->control.vad_active;
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static const struct snd_kcontrol_new zg01_vad_ctl = {
+    .iface = SNDRV_CTL_ELEM_IFACE_PCM,
+    .name = "Voice Activity",
+    .access = SNDRV_CTL_ELEM_ACCESS_READ | SNDRV_CTL_ELEM_ACCESS_VOLATILE,
+    .info = snd_ctl_boolean_mono_info,
+    .get = zg01_vad_get,
+};
+
+/*
+ * Device controls (mute, knob, mic source). Values live in the shared
+ * context's write-behind cache: get never touches USB, put only queues
+ * the write. private_value is the ZG01_HWCTL_* index.
+ */
+static int zg01_hwctl_get(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    int id = kcontrol->private_value;
+    int v = zg01_shared_hwctl_get(dev->shared, id);
+
+    if (id == ZG01_HWCTL_VOLUME) {      /* 1/256 dB to steps of the device's range */
+        int min, max, res;
+
+        zg01_shared_hwctl_range(dev->shared, &min, &max, &res);
+        v = clamp(v, min, max);
+        v = (v - min + res / 2) / res;
+    } else if (id == ZG01_HWCTL_MIC_SELECT)   /* On = phono, the selector's first input */
+        v = (v == 0);
+    ucontrol->value.integer.value[0] = v;
+    return 0;
+}
+
+static int zg01_hwctl_put(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_value *ucontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    int id = kcontrol->private_value;
+    long v = ucontrol->value.integer.value[0];
+
+    if (id == ZG01_HWCTL_VOLUME) {
+        int min, max, res;
+
+        zg01_shared_hwctl_range(dev->shared, &min, &max, &res);
+        if (v < 0 || v > (max - min) / res)
+            return -EINVAL;
+        v = min + v * res;
+    } else {
+        if (v < 0 || v > 1)
+            return -EINVAL;
+        if (id == ZG01_HWCTL_MIC_SELECT)
+            v = !v;
+    }
+
+    return zg01_shared_hwctl_put(dev->shared, id, v);
+}
+
+/* Knob steps span the range the device reported at bring-up */
+static int zg01_knob_info(struct snd_kcontrol *kcontrol, struct snd_ctl_elem_info *uinfo)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    int min, max, res;
+
+    zg01_shared_hwctl_range(dev->shared, &min, &max, &res);
+    uinfo->type = SNDRV_CTL_ELEM_TYPE_INTEGER;
+    uinfo->count = 1;
+    uinfo->value.integer.min = 0;
+    uinfo->value.integer.max = (max - min) / res;
+    return 0;
+}
+
+/*
+ * dB scale of the knob from the same range. Step 0 is the device's
+ * minimum, not mute (mute is its own control), so no mute flag.
+ */
+static int zg01_knob_tlv(struct snd_kcontrol *kcontrol, int op_flag, unsigned int size,
+                         unsigned int __user *tlv)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    unsigned int scale[4];
+    int min, max, res;
+
+    if (op_flag != SNDRV_CTL_TLV_OP_READ)
+        return -ENXIO;
+    if (size < sizeof(scale))
+        return -ENOMEM;
+
+    zg01_shared_hwctl_range(dev->shared, &min, &max, &res);
+    scale[0] = SNDRV_CTL_TLVT_DB_SCALE;
+    scale[1] = 2 * sizeof(unsigned int);
+    scale[2] = (unsigned int)(min * 100 / 256);    /* 0.01 dB */
+    scale[3] = res * 100 / 256;
+    if (copy_to_user(tlv, scale, sizeof(scale)))
+        return -EFAULT;
+    return 0;
+}
+
+/*
+ * Stop change events before the control goes away with the card. A change
+ * report or write-behind batch already under way finishes first, so no
+ * update is left touching the control once it is detached.
+ */
+static void zg01_hwctl_free(struct snd_kcontrol *kcontrol)
+{
+    struct zg01_dev *dev = snd_kcontrol_chip(kcontrol);
+    struct zg01_shared *sh = dev->shared;
+
+    cancel_work_sync(&sh->notify.work);
+    flush_delayed_work(&sh->hwctl.flush);
+    zg01_shared_hwctl_attach(sh, kcontrol->private_value, NULL, NULL);
+}
+
+static const struct snd_kcontrol_new zg01_hwctls[ZG01_HWCTL_NR] = {
+    [ZG01_HWCTL_MUTE] = {
+        .iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+        .name = "Hardware Mute",
+        .access = SNDRV_CTL_ELEM_ACCESS_READWRITE,
+        .info = snd_ctl_boolean_mono_info,
+        .get = zg01_hwctl_get,
+        .put = zg01_hwctl_put,
+        .private_value = ZG01_HWCTL_MUTE,
+    },
+    [ZG01_HWCTL_VOLUME] = {
+        .iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+        .name = "Hardware Knob Volume",
+        .access = SNDRV_CTL_ELEM_ACCESS_READWRITE | SNDRV_CTL_ELEM_ACCESS_TLV_READ |
+                  SNDRV_CTL_ELEM_ACCESS_TLV_CALLBACK,
+        .info = zg01_knob_info,
+        .get = zg01_hwctl_get,
+        .put = zg01_hwctl_put,
+        .tlv = { .c = zg01_knob_tlv },
+        .private_value = ZG01_HWCTL_VOLUME,
+    },
+    [ZG01_HWCTL_MIC_SELECT] = {
+        .iface = SNDRV_CTL_ELEM_IFACE_MIXER,
+        .name = "Phono Mic Switch",
+        .access = SNDRV_CTL_ELEM_ACCESS_READWRITE,
+        .info = snd_ctl_boolean_mono_info,
+        .get = zg01_hwctl_get,
+        .put = zg01_hwctl_put,
+        .private_value = ZG01_HWCTL_MIC_SELECT,
+    },
+};
+
+/* Slot mask (bit n = wire slot n) per PCM channel of a playback stream */
+static const struct snd_kcontrol_new zg01_route_ctl = {
+    .iface = SNDRV_CTL_ELEM_IFACE_PCM,
+    .name = "Playback Route",
+    .access = SNDRV_CTL_ELEM_ACCESS_READWRITE,
+    .info = zg01_route_info,
+    .get = zg01_route_get,
+    .put = zg01_route_put,
+};
+
+/* Create the ALSA controls of one channel; called before the card is registered */
+int zg01_create_mixer(struct zg01_dev *dev)
+{
+    struct snd_kcontrol *kctl;
+    int ret;
+
+    if (!dev || !dev->card)
+        return -ENODEV;
+
+    dev->control.zg01 = dev;
+    dev->control.route_mask[0] = ZG01_ROUTE_DEFAULT_L;
+    dev->control.route_mask[1] = ZG01_ROUTE_DEFAULT_R;
+    zg01_route_compile(&dev->control);
+
+    dev->control.volume[0] = dev->control.volume[1] = ZG01_VOLUME_MAX;
+    dev->control.volume_switch[0] = dev->control.volume_switch[1] = true;
+    zg01_volume_update(&dev->control);
+    dev->control.gain_cur[0] = dev->control.gain_target[0];
+    dev->control.gain_cur[1] = dev->control.gain_target[1];
+
+    /* Meters are published before the controls exist; only take notify targets once added */
+    kctl = snd_ctl_new1(&zg01_meter_peak_ctl, dev);
+    if (!kctl)
+        return -ENOMEM;
+    kctl->id.device = dev->pcm_device;
+    ret = snd_ctl_add(dev->card, kctl);
+    if (ret < 0) {
+        pr_err("zg01_control: Failed to add peak meter control: %d\n", ret);
+        return ret;
+    }
+    dev->control.meter_peak_kctl = kctl;
+
+    kctl = snd_ctl_new1(&zg01_meter_rms_ctl, dev);
+    if (!kctl)
+        return -ENOMEM;
+    kctl->id.device = dev->pcm_device;
+    ret = snd_ctl_add(dev->card, kctl);
+    if (ret < 0) {
+        dev->control.meter_peak_kctl = NULL;
+        pr_err("zg01_control: Failed to add RMS meter control: %d\n", ret);
+        return ret;
+    }
+    dev->control.meter_rms_kctl = kctl;
+
+    if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
+        struct zg01_mix *mix = &dev->shared->mix;
+        unsigned long flags;
+        int i;
+
+        /* Stream mix starts with every source at 0 dB */
+        spin_lock_irqsave(&mix->lock, flags);
+        for (i = 0; i < ZG01_NUM_CHANNELS; i++) {
+            mix->volume[i] = ZG01_VOLUME_MAX;
+            mix->gain[i] = ZG01_GAIN_UNITY;
+        }
+        spin_unlock_irqrestore(&mix->lock, flags);
+
+        kctl = snd_ctl_new1(&zg01_vad_ctl, dev);
+        if (!kctl)
+            return -ENOMEM;
+        kctl->id.device = dev->pcm_device;
+        ret = snd_ctl_add(dev->card, kctl);
+        if (ret < 0) {
+            pr_err("zg01_control: Failed to add voice activity control: %d\n", ret);
+            return ret;
+        }
+        dev->control.vad_kctl = kctl;
+
+        /* Device controls live on the Voice In card, those the descriptors have */
+        for (i = 0; i < ZG01_HWCTL_NR; i++) {
+            if (!zg01_shared_hwctl_present(dev->shared, i))
+                continue;
+            kctl = snd_ctl_new1(&zg01_hwctls[i], dev);
+            if (!kctl)
+                return -ENOMEM;
+            kctl->private_free = zg01_hwctl_free;
+            ret = snd_ctl_add(dev->card, kctl);
+            if (ret < 0) {
+                pr_err("zg01_control: Failed to add %s control: %d\n", zg01_hwctls[i].name, ret);
+                return ret;
+            }
+            zg01_shared_hwctl_attach(dev->shared, i, dev->card, kctl);
+        }
+
+        for (i = 0; i < ARRAY_SIZE(zg01_mix_ctls); i++) {
+            kctl = snd_ctl_new1(&zg01_mix_ctls[i], dev);
+            if (!kctl)
+                return -ENOMEM;
+            ret = snd_ctl_add(dev->card, kctl);
+            if (ret < 0) {
+                pr_err("zg01_control: Failed to add stream mix control: %d\n", ret);
+                return ret;
+            }
+        }
+        return 0;
+    }
+
+    kctl = snd_ctl_new1(&zg01_route_ctl, dev);
+    if (!kctl)
+        return -ENOMEM;
+    kctl->id.device = dev->pcm_device;
+    ret = snd_ctl_add(dev->card, kctl);
+    if (ret < 0) {
+        pr_err("zg01_control: Failed to add routing control: %d\n", ret);
+        return ret;
+    }
+
+    /* Game and Voice Out share a card in the single-card topology: index by PCM device */
+    kctl = snd_ctl_new1(&zg01_volume_ctl, dev);
+    if (!kctl)
+        return -ENOMEM;
+    kctl->id.index = dev->pcm_device;
+    ret = snd_ctl_add(dev->card, kctl);
+    if (ret < 0) {
+        pr_err("zg01_control: Failed to add volume control: %d\n", ret);
+        return ret;
+    }
+
+    kctl = snd_ctl_new1(&zg01_switch_ctl, dev);
+    if (!kctl)
+        return -ENOMEM;
+    kctl->id.index = dev->pcm_device;
+    ret = snd_ctl_add(dev->card, kctl);
+    if (ret < 0) {
+        pr_err("zg01_control: Failed to add switch control: %d\n", ret);
+        return ret;
+    }
+
+    kctl = snd_ctl_new1(&zg01_sidetone_ctl, dev);
+    if (!kctl)
+        return -ENOMEM;
+    kctl->id.index = dev->pcm_device;
+    ret = snd_ctl_add(dev->card, kctl);
+    if (ret < 0) {
+        pr_err("zg01_control: Failed to add sidetone control: %d\n", ret);
+        return ret;
+    }
+
+    return 0;
+}
+
+EXPORT_SYMBOL_GPL(zg01_create_mixer);
+
 MODULE_AUTHOR("Your Name");
 MODULE_DESCRIPTION("Yamaha ZG01 USB Audio Driver - Control Interface");
 MODULE_LICENSE("GPL");
@@ -3,13 +3,57 @@
 
 struct zg01_dev;
 
+/* 32-bit slots in a 40-byte playback wire frame; stereo lands in slots 2-3 */
+#define ZG01_FRAME_SLOTS	10
+#define ZG01_ROUTE_DEFAULT_L	(1 << 2)
+#define ZG01_ROUTE_DEFAULT_R	(1 << 3)
+
+/* Playback volume: 0.5 dB steps from -60 dB (mute) to 0 dB, Q8.24 gain */
+#define ZG01_VOLUME_MAX		120
+#define ZG01_GAIN_SHIFT		24
+#define ZG01_GAIN_UNITY		(1U << ZG01_GAIN_SHIFT)
+
 struct zg01_control {
 	struct zg01_dev *zg01;
 
-	bool phono_mic_switch;
+	/* Playback routing: slot mask per PCM channel, compiled per slot.
+	 * Updated and read under zg01_dev.lock. */
+	u16 route_mask[2];
+	s8 route_src[ZG01_FRAME_SLOTS];	/* -1 = silence, 0 = left, 1 = right */
+	bool route_default;		/* Left -> slot 2, right -> slot 3 only */
+
+	/* Playback volume per PCM channel. gain_target follows the controls,
+	 * gain_cur is where the packer's per-URB ramp ended. Under zg01_dev.lock. */
+	int volume[2];
+	bool volume_switch[2];
+	u32 gain_target[2];
+	u32 gain_cur[2];
+
+	/* Level meters of the last URB per PCM channel. Under zg01_dev.lock. */
+	u32 meter_peak[2];		/* Peak magnitude, S32 scale */
+	u64 meter_meansq[2];		/* Mean square of the upper 16 bits */
+	struct snd_kcontrol *meter_peak_kctl;
+	struct snd_kcontrol *meter_rms_kctl;
+	unsigned long meter_notify_next;	/* jiffies */
+
+	/* Sidetone mixed into this playback stream (0 = off). Gain under
+	 * zg01_dev.lock; the read position is owned by the packer. */
+	int sidetone_volume;
+	u32 sidetone_gain;
+	unsigned int sidetone_pos;
+
+	/* Voice activity of the Voice In stream. Under zg01_dev.lock. */
+	bool vad_active;
+	unsigned int vad_hang;		/* Frames until activity drops */
+	struct snd_kcontrol *vad_kctl;
 };
 
 int zg01_init_control(struct zg01_dev *zg01);
 void zg01_free_control(struct zg01_dev *zg01);
+int zg01_create_mixer(struct zg01_dev *zg01);
+void zg01_meter_publish(struct zg01_dev *zg01, const u32 *peak, const u64 *sumsq,
+			unsigned int frames);
+void zg01_vad_publish(struct zg01_dev *zg01, const u64 *sumsq, unsigned int crossings,
+		      unsigned int frames, unsigned int rate);
 
 #endif
\ No newline at end of file
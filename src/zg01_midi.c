@@ -0,0 +1,603 @@
+/*
+ * Yamaha ZG01 USB Audio Driver - MIDI Interface
+ *
+ * Interface 3 (vendor class, MIDIStreaming subclass) carries USB-MIDI 1.0
+ * event packets on bulk endpoints 0x02 OUT and 0x82 IN, as other Yamaha
+ * devices do. One rawmidi port on the Game card (or the single card).
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/delay.h>
+#include <linux/usb.h>
+#include <sound/core.h>
+#include <sound/rawmidi.h>
+#include "zg01.h"
+
+#define ZG01_MIDI_IFACE     3
+#define ZG01_MIDI_IN_URBS   4       /* Always queued while the input is open */
+#define ZG01_MIDI_RETRY_MS  100     /* Back-off before requeueing after a transfer error */
+#define ZG01_MIDI_DRAIN_MS  500     /* Longest wait for written bytes to leave at drain */
+
+/* Bits of zg01_midi.halted: endpoints to clear a stall on from process context */
+enum {
+    ZG01_MIDI_HALT_IN,
+    ZG01_MIDI_HALT_OUT,
+};
+
+/* Output parser states (byte stream to event packets) */
+enum {
+    ZG01_MIDI_STATE_UNKNOWN,
+    ZG01_MIDI_STATE_1PARAM,
+    ZG01_MIDI_STATE_2PARAM_1,
+    ZG01_MIDI_STATE_2PARAM_2,
+    ZG01_MIDI_STATE_SYSEX_0,
+    ZG01_MIDI_STATE_SYSEX_1,
+    ZG01_MIDI_STATE_SYSEX_2,
+};
+
+struct zg01_midi {
+    struct zg01_dev *zg01;
+    struct snd_rawmidi *rmidi;
+    struct usb_device *udev;
+    struct usb_interface *intf;     /* Interface 3 */
+    struct usb_driver *driver;
+    bool claimed;           /* Interface 3 bound to driver until disconnect */
+
+    spinlock_t lock;        /* Substream pointers, output state */
+
+    /* Input: bulk IN URBs kept queued so a packet is handed on as soon as it lands */
+    struct urb *in_urbs[ZG01_MIDI_IN_URBS];
+    struct usb_anchor in_anchor;
+    struct snd_rawmidi_substream *in_substream;    /* While triggered */
+    bool in_open;           /* Under lock */
+    unsigned long in_idle;  /* Bit per IN URB left out of the queue by an error */
+
+    /* Error recovery: clear stalls and requeue, never from completion context */
+    struct delayed_work recover;
+    unsigned long halted;   /* ZG01_MIDI_HALT_* */
+
+    /* Output: one transfer in flight; bytes written meanwhile go out together in the next */
+    struct urb *out_urb;
+    unsigned int out_size;
+    bool out_busy;
+    struct snd_rawmidi_substream *out_substream;   /* While triggered */
+    u8 out_state;
+    u8 out_data[2];
+};
+
+/* Bytes carried by an event packet, by Code Index Number */
+static const u8 zg01_midi_cin_len[16] = {
+    0, 0, 2, 3, 3, 1, 2, 3, 3, 3, 3, 3, 2, 2, 3, 1
+};
+
+static unsigned int zg01_midi_packet(u8 *p, u8 cin, u8 b0, u8 b1, u8 b2)
+{
+    p[0] = cin;             /* Cable 0 */
+    p[1] = b0;
+    p[2] = b1;
+    p[3] = b2;
+    return 4;
+}
+
+/*
+ * Feed one byte of the output stream; returns the bytes of event packet
+ * written to @p (0 or 4). Running status is kept for channel messages.
+ */
+static unsigned int zg01_midi_encode(struct zg01_midi *m, u8 b, u8 *p)
+{
+    if (b >= 0xf8)
+        return zg01_midi_packet(p, 0x0f, b, 0, 0);
+
+    if (b >= 0xf0) {
+        switch (b) {
+        case 0xf0:
+            m->out_data[0] = b;
+            m->out_state = ZG01_MIDI_STATE_SYSEX_1;
+            return 0;
+        case 0xf1:
+        case 0xf3:
+            m->out_data[0] = b;
+            m->out_state = ZG01_MIDI_STATE_1PARAM;
+            return 0;
+        case 0xf2:
+            m->out_data[0] = b;
+            m->out_state = ZG01_MIDI_STATE_2PARAM_1;
+            return 0;
+        case 0xf6:
+            m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+            return zg01_midi_packet(p, 0x05, b, 0, 0);
+        case 0xf7:
+            switch (m->out_state) {
+            case ZG01_MIDI_STATE_SYSEX_0:
+                m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+                return zg01_midi_packet(p, 0x05, b, 0, 0);
+            case ZG01_MIDI_STATE_SYSEX_1:
+                m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+                return zg01_midi_packet(p, 0x06, m->out_data[0], b, 0);
+            case ZG01_MIDI_STATE_SYSEX_2:
+                m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+                return zg01_midi_packet(p, 0x07, m->out_data[0], m->out_data[1], b);
+            }
+            /* fall through */
+        default:
+            m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+            return 0;
+        }
+    }
+
+    if (b >= 0x80) {
+        m->out_data[0] = b;
+        m->out_state = (b >= 0xc0 && b <= 0xdf) ? ZG01_MIDI_STATE_1PARAM :
+                                                  ZG01_MIDI_STATE_2PARAM_1;
+        return 0;
+    }
+
+    switch (m->out_state) {
+    case ZG01_MIDI_STATE_1PARAM:
+        if (m->out_data[0] < 0xf0)
+            return zg01_midi_packet(p, m->out_data[0] >> 4, m->out_data[0], b, 0);
+        m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+        return zg01_midi_packet(p, 0x02, m->out_data[0], b, 0);
+    case ZG01_MIDI_STATE_2PARAM_1:
+        m->out_data[1] = b;
+        m->out_state = ZG01_MIDI_STATE_2PARAM_2;
+        return 0;
+    case ZG01_MIDI_STATE_2PARAM_2:
+        if (m->out_data[0] < 0xf0) {
+            m->out_state = ZG01_MIDI_STATE_2PARAM_1;
+            return zg01_midi_packet(p, m->out_data[0] >> 4, m->out_data[0], m->out_data[1], b);
+        }
+        m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+        return zg01_midi_packet(p, 0x03, m->out_data[0], m->out_data[1], b);
+    case ZG01_MIDI_STATE_SYSEX_0:
+        m->out_data[0] = b;
+        m->out_state = ZG01_MIDI_STATE_SYSEX_1;
+        return 0;
+    case ZG01_MIDI_STATE_SYSEX_1:
+        m->out_data[1] = b;
+        m->out_state = ZG01_MIDI_STATE_SYSEX_2;
+        return 0;
+    case ZG01_MIDI_STATE_SYSEX_2:
+        m->out_state = ZG01_MIDI_STATE_SYSEX_0;
+        return zg01_midi_packet(p, 0x04, m->out_data[0], m->out_data[1], b);
+    }
+    return 0;
+}
+
+/*
+ * Pack everything pending (up to one max-size transfer) and send it.
+ * Called with m->lock held, from trigger and from the OUT completion.
+ */
+static void zg01_midi_out_kick(struct zg01_midi *m)
+{
+    u8 *buf = m->out_urb->transfer_buffer;
+    unsigned int len = 0;
+    u8 b;
+
+    if (m->out_busy || !m->out_substream)
+        return;
+
+    while (len + 4 <= m->out_size && snd_rawmidi_transmit(m->out_substream, &b, 1) == 1)
+        len += zg01_midi_encode(m, b, buf + len);
+    if (!len)
+        return;
+
+    m->out_urb->transfer_buffer_length = len;
+    if (usb_submit_urb(m->out_urb, GFP_ATOMIC) == 0)
+        m->out_busy = true;
+}
+
+/*
+ * Sort a failed transfer: 0 if it was killed or the device is gone,
+ * -EPROTO for errors that mean the link is broken (stop, as snd-usbmidi
+ * does), -EPIPE for a stall to clear, or the delay in jiffies before
+ * retrying anything else (a babbling or flaky endpoint must not spin
+ * in completion context).
+ */
+static long zg01_midi_error(struct zg01_midi *m, int status, int dir)
+{
+    switch (status) {
+    case -ENOENT:
+    case -ECONNRESET:
+    case -ESHUTDOWN:
+    case -ENODEV:
+        return 0;
+    case -EPROTO:
+    case -EILSEQ:
+    case -ETIME:
+        pr_warn_once("zg01_midi: MIDI %s transfer failed (%d), not retried\n",
+                     dir == ZG01_MIDI_HALT_IN ? "input" : "output", status);
+        return -EPROTO;
+    case -EPIPE:
+        set_bit(dir, &m->halted);
+        return -EPIPE;
+    default:
+        return msecs_to_jiffies(ZG01_MIDI_RETRY_MS);
+    }
+}
+
+static void zg01_midi_out_complete(struct urb *urb)
+{
+    struct zg01_midi *m = urb->context;
+    unsigned long flags;
+    long err = 0;
+
+    if (urb->status)
+        err = zg01_midi_error(m, urb->status, ZG01_MIDI_HALT_OUT);
+
+    spin_lock_irqsave(&m->lock, flags);
+    m->out_busy = false;
+    if (!urb->status)
+        zg01_midi_out_kick(m);
+    spin_unlock_irqrestore(&m->lock, flags);
+
+    /* The recovery work sends what is still pending */
+    if (err == -EPIPE)
+        schedule_delayed_work(&m->recover, 0);
+    else if (err > 0)
+        schedule_delayed_work(&m->recover, err);
+}
+
+static void zg01_midi_in_complete(struct urb *urb)
+{
+    struct zg01_midi *m = urb->context;
+    const u8 *p = urb->transfer_buffer;
+    unsigned long flags;
+    long err;
+    int i;
+
+    if (urb->status) {
+        err = zg01_midi_error(m, urb->status, ZG01_MIDI_HALT_IN);
+        if (err == -EPIPE || err > 0) {
+            for (i = 0; i < ZG01_MIDI_IN_URBS; i++)
+                if (m->in_urbs[i] == urb)
+                    set_bit(i, &m->in_idle);
+            schedule_delayed_work(&m->recover, err > 0 ? err : 0);
+        }
+        return;
+    }
+
+    spin_lock_irqsave(&m->lock, flags);
+    if (m->in_substream) {
+        for (i = 0; i + 4 <= urb->actual_length; i += 4) {
+            unsigned int n = zg01_midi_cin_len[p[i] & 0x0f];
+
+            if (n)
+                snd_rawmidi_receive(m->in_substream, p + i + 1, n);
+        }
+    }
+    spin_unlock_irqrestore(&m->lock, flags);
+
+    usb_anchor_urb(urb, &m->in_anchor);
+    if (usb_submit_urb(urb, GFP_ATOMIC) < 0)
+        usb_unanchor_urb(urb);
+}
+
+/* Clear stalls, then requeue the IN URBs an error left out and restart the output */
+static void zg01_midi_recover(struct work_struct *work)
+{
+    struct zg01_midi *m = container_of(to_delayed_work(work), struct zg01_midi, recover);
+    unsigned long flags;
+    int i;
+
+    if (test_and_clear_bit(ZG01_MIDI_HALT_IN, &m->halted))
+        usb_clear_halt(m->udev, m->in_urbs[0]->pipe);
+    if (test_and_clear_bit(ZG01_MIDI_HALT_OUT, &m->halted))
+        usb_clear_halt(m->udev, m->out_urb->pipe);
+
+    /* Under the lock, so a close either sees the URB anchored and kills it or we see it closed */
+    spin_lock_irqsave(&m->lock, flags);
+    for (i = 0; i < ZG01_MIDI_IN_URBS; i++) {
+        if (!test_and_clear_bit(i, &m->in_idle) || !m->in_open)
+            continue;
+        usb_anchor_urb(m->in_urbs[i], &m->in_anchor);
+        if (usb_submit_urb(m->in_urbs[i], GFP_ATOMIC) < 0)
+            usb_unanchor_urb(m->in_urbs[i]);
+    }
+    zg01_midi_out_kick(m);
+    spin_unlock_irqrestore(&m->lock, flags);
+}
+
+/* Queue every IN URB; a completion only has to hand on its packets and go again */
+static int zg01_midi_in_start(struct zg01_midi *m, gfp_t gfp)
+{
+    int i, ret;
+
+    m->in_idle = 0;
+    for (i = 0; i < ZG01_MIDI_IN_URBS; i++) {
+        usb_anchor_urb(m->in_urbs[i], &m->in_anchor);
+        ret = usb_submit_urb(m->in_urbs[i], gfp);
+        if (ret < 0) {
+            usb_unanchor_urb(m->in_urbs[i]);
+            usb_kill_anchored_urbs(&m->in_anchor);
+            return ret;
+        }
+    }
+    return 0;
+}
+
+static int zg01_midi_input_open(struct snd_rawmidi_substream *substream)
+{
+    struct zg01_midi *m = substream->rmidi->private_data;
+    unsigned long flags;
+    int ret;
+
+    ret = usb_autopm_get_interface(m->intf);
+    if (ret < 0)
+        return ret;
+
+    ret = zg01_midi_in_start(m, GFP_KERNEL);
+    if (ret < 0) {
+        usb_autopm_put_interface(m->intf);
+        pr_err("zg01_midi: Failed to start MIDI input: %d\n", ret);
+        return ret;
+    }
+    spin_lock_irqsave(&m->lock, flags);
+    m->in_open = true;
+    spin_unlock_irqrestore(&m->lock, flags);
+    return 0;
+}
+
+static int zg01_midi_input_close(struct snd_rawmidi_substream *substream)
+{
+    struct zg01_midi *m = substream->rmidi->private_data;
+    unsigned long flags;
+
+    spin_lock_irqsave(&m->lock, flags);
+    m->in_open = false;
+    spin_unlock_irqrestore(&m->lock, flags);
+    usb_kill_anchored_urbs(&m->in_anchor);
+    usb_autopm_put_interface(m->intf);
+    return 0;
+}
+
+static void zg01_midi_input_trigger(struct snd_rawmidi_substream *substream, int up)
+{
+    struct zg01_midi *m = substream->rmidi->private_data;
+    unsigned long flags;
+
+    spin_lock_irqsave(&m->lock, flags);
+    m->in_substream = up ? substream : NULL;
+    spin_unlock_irqrestore(&m->lock, flags);
+}
+
+static int zg01_midi_output_open(struct snd_rawmidi_substream *substream)
+{
+    struct zg01_midi *m = substream->rmidi->private_data;
+
+    m->out_state = ZG01_MIDI_STATE_UNKNOWN;
+    return usb_autopm_get_interface(m->intf);
+}
+
+static int zg01_midi_output_close(struct snd_rawmidi_substream *substream)
+{
+    struct zg01_midi *m = substream->rmidi->private_data;
+
+    usb_kill_urb(m->out_urb);
+    usb_autopm_put_interface(m->intf);
+    return 0;
+}
+
+static void zg01_midi_output_trigger(struct snd_rawmidi_substream *substream, int up)
+{
+    struct zg01_midi *m = substream->rmidi->private_data;
+    unsigned long flags;
+
+    spin_lock_irqsave(&m->lock, flags);
+    m->out_substream = up ? substream : NULL;
+    zg01_midi_out_kick(m);
+    spin_unlock_irqrestore(&m->lock, flags);
+}
+
+/*
+ * Wait until everything written has left: the rawmidi buffer empty and no
+ * transfer in flight. Bounded, so a stalled endpoint can't hold up close.
+ */
+static void zg01_midi_output_drain(struct snd_rawmidi_substream *substream)
+{
+    struct zg01_midi *m = substream->rmidi->private_data;
+    unsigned long timeout = jiffies + msecs_to_jiffies(ZG01_MIDI_DRAIN_MS);
+    unsigned long flags;
+    bool done;
+
+    for (;;) {
+        spin_lock_irqsave(&m->lock, flags);
+        done = !m->out_busy && snd_rawmidi_transmit_empty(substream);
+        spin_unlock_irqrestore(&m->lock, flags);
+        if (done)
+            return;
+        if (time_after(jiffies, timeout)) {
+            pr_warn("zg01_midi: MIDI output not drained within %d ms\n", ZG01_MIDI_DRAIN_MS);
+            return;
+        }
+        msleep(1);
+    }
+}
+
+static const struct snd_rawmidi_ops zg01_midi_output_ops = {
+    .open = zg01_midi_output_open,
+    .close = zg01_midi_output_close,
+    .trigger = zg01_midi_output_trigger,
+    .drain = zg01_midi_output_drain,
+};
+
+static const struct snd_rawmidi_ops zg01_midi_input_ops = {
+    .open = zg01_midi_input_open,
+    .close = zg01_midi_input_close,
+    .trigger = zg01_midi_input_trigger,
+};
+
+static void zg01_midi_free_urbs(struct zg01_midi *m)
+{
+    int i;
+
+    cancel_delayed_work_sync(&m->recover);
+    for (i = 0; i < ZG01_MIDI_IN_URBS; i++) {
+        if (!m->in_urbs[i])
+            continue;
+        usb_kill_urb(m->in_urbs[i]);
+        kfree(m->in_urbs[i]->transfer_buffer);
+        usb_free_urb(m->in_urbs[i]);
+    }
+    if (m->out_urb) {
+        usb_kill_urb(m->out_urb);
+        kfree(m->out_urb->transfer_buffer);
+        usb_free_urb(m->out_urb);
+    }
+}
+
+static void zg01_midi_private_free(struct snd_rawmidi *rmidi)
+{
+    struct zg01_midi *m = rmidi->private_data;
+
+    m->zg01->midi = NULL;
+    zg01_midi_free_urbs(m);
+    kfree(m);
+}
+
+/* Allocate an URB with its own transfer buffer */
+static struct urb *zg01_midi_alloc_urb(struct zg01_midi *m, unsigned int pipe,
+                                       unsigned int size, usb_complete_t complete)
+{
+    struct urb *urb = usb_alloc_urb(0, GFP_KERNEL);
+    void *buf = kmalloc(size, GFP_KERNEL);
+
+    if (!urb || !buf) {
+        usb_free_urb(urb);
+        kfree(buf);
+        return NULL;
+    }
+    usb_fill_bulk_urb(urb, m->udev, pipe, buf, size, complete, m);
+    return urb;
+}
+
+/*
+ * Create the rawmidi port of the device on @dev's card and claim interface
+ * 3 for @driver, so nothing else binds the endpoints. Returns -ENODEV (and
+ * creates nothing) if interface 3 has no bulk endpoint pair.
+ */
+int zg01_create_midi(struct zg01_dev *dev, struct usb_driver *driver)
+{
+    struct usb_endpoint_descriptor *ep_in, *ep_out;
+    struct usb_interface *intf;
+    struct zg01_midi *m;
+    struct snd_rawmidi *rmidi;
+    int i, ret;
+
+    intf = usb_ifnum_to_if(dev->udev, ZG01_MIDI_IFACE);
+    if (!intf || usb_find_common_endpoints(&intf->altsetting[0], &ep_in, &ep_out, NULL, NULL))
+        return -ENODEV;
+
+    m = kzalloc(sizeof(*m), GFP_KERNEL);
+    if (!m)
+        return -ENOMEM;
+    m->zg01 = dev;
+    m->udev = dev->udev;
+    m->driver = driver;
+    spin_lock_init(&m->lock);
+    init_usb_anchor(&m->in_anchor);
+    INIT_DELAYED_WORK(&m->recover, zg01_midi_recover);
+
+    for (i = 0; i < ZG01_MIDI_IN_URBS; i++) {
+        m->in_urbs[i] = zg01_midi_alloc_urb(m, usb_rcvbulkpipe(m->udev, ep_in->bEndpointAddress),
+                                            usb_endpoint_maxp(ep_in), zg01_midi_in_complete);
+        if (!m->in_urbs[i])
+            goto nomem;
+    }
+    m->out_size = usb_endpoint_maxp(ep_out) & ~3U;
+    m->out_urb = zg01_midi_alloc_urb(m, usb_sndbulkpipe(m->udev, ep_out->bEndpointAddress),
+                                     m->out_size, zg01_midi_out_complete);
+    if (!m->out_urb || m->out_size < 4)
+        goto nomem;
+
+    /* No interface data: the driver's own callbacks leave interface 3 alone */
+    ret = usb_driver_claim_interface(driver, intf, NULL);
+    if (ret < 0) {
+        pr_err("zg01_midi: Failed to claim interface %d: %d\n", ZG01_MIDI_IFACE, ret);
+        goto free;
+    }
+    m->intf = intf;
+    m->claimed = true;
+
+    ret = snd_rawmidi_new(dev->card, "ZG01 MIDI", 0, 1, 1, &rmidi);
+    if (ret < 0) {
+        usb_driver_release_interface(driver, intf);
+        goto free;
+    }
+
+    strscpy(rmidi->name, "Yamaha ZG01 MIDI", sizeof(rmidi->name));
+    rmidi->info_flags = SNDRV_RAWMIDI_INFO_OUTPUT | SNDRV_RAWMIDI_INFO_INPUT |
+                        SNDRV_RAWMIDI_INFO_DUPLEX;
+    rmidi->private_data = m;
+    rmidi->private_free = zg01_midi_private_free;
+    snd_rawmidi_set_ops(rmidi, SNDRV_RAWMIDI_STREAM_OUTPUT, &zg01_midi_output_ops);
+    snd_rawmidi_set_ops(rmidi, SNDRV_RAWMIDI_STREAM_INPUT, &zg01_midi_input_ops);
+
+    m->rmidi = rmidi;
+    dev->midi = m;
+    pr_info("zg01_midi: MIDI on EP 0x%02x IN / 0x%02x OUT, %d IN URBs queued while open\n",
+            ep_in->bEndpointAddress, ep_out->bEndpointAddress, ZG01_MIDI_IN_URBS);
+    return 0;
+
+nomem:
+    ret = -ENOMEM;
+free:
+    zg01_midi_free_urbs(m);
+    kfree(m);
+    return ret;
+}
+
+/* Stop all MIDI transfers and the error recovery */
+static void zg01_midi_stop(struct zg01_midi *m)
+{
+    cancel_delayed_work_sync(&m->recover);
+    usb_kill_anchored_urbs(&m->in_anchor);
+    usb_kill_urb(m->out_urb);
+}
+
+/* Disconnect: stop the transfers and give interface 3 back; the port itself goes with the card */
+void zg01_free_midi(struct zg01_dev *dev)
+{
+    struct zg01_midi *m = dev->midi;
+
+    if (!m)
+        return;
+    zg01_midi_stop(m);
+    if (m->claimed) {
+        usb_driver_release_interface(m->driver, m->intf);
+        m->claimed = false;
+    }
+}
+
+void zg01_midi_suspend(struct zg01_dev *dev)
+{
+    if (dev->midi)
+        zg01_midi_stop(dev->midi);
+}
+
+/* Requeue the input and send what was written while suspended */
+void zg01_midi_resume(struct zg01_dev *dev)
+{
+    struct zg01_midi *m = dev->midi;
+    unsigned long flags;
+
+    if (!m)
+        return;
+
+    if (m->in_open && zg01_midi_in_start(m, GFP_NOIO) < 0)
+        pr_warn("zg01_midi: MIDI input not restarted after resume\n");
+
+    spin_lock_irqsave(&m->lock, flags);
+    zg01_midi_out_kick(m);
+    spin_unlock_irqrestore(&m->lock, flags);
+}
+
+EXPORT_SYMBOL_GPL(zg01_create_midi);
+EXPORT_SYMBOL_GPL(zg01_free_midi);
+EXPORT_SYMBOL_GPL(zg01_midi_suspend);
+EXPORT_SYMBOL_GPL(zg01_midi_resume);
+
+MODULE_AUTHOR("ZG01 Driver Team");
+MODULE_DESCRIPTION("Yamaha ZG01 USB Audio Driver - MIDI Interface");
+MODULE_LICENSE("GPL");
@@ -1,8 +1,11 @@
 #include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/delay.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
 #include <sound/pcm_params.h>
 #include "zg01.h"
+#include "zg01_control.h"
 #include <linux/workqueue.h>
 #include <linux/jiffies.h>
 
@@ -32,8 +35,183 @@ static void zg01_pcm_start_work(struct work_struct *work)
 #define ZG01_EP_AUDIO_IN   0x81   /* Audio input endpoint */
 
 /* Forward declarations */
-static int zg01_start_streaming(struct zg01_dev *dev, struct snd_pcm_substream *substream);
+static int zg01_alloc_streaming(struct zg01_dev *dev);
+static int zg01_start_streaming(struct zg01_dev *dev, struct snd_pcm_substream *substream,
+                                int start_frame);
 static void zg01_stop_streaming(struct zg01_dev *dev);
+static void zg01_preroll_work(struct work_struct *work);
+static int zg01_pcm_trigger(struct snd_pcm_substream *substream, int cmd);
+
+/* Frames between a linked start being triggered and the streams starting */
+#define ZG01_LINK_START_DELAY_FRAMES 4
+
+/* Bus frame numbers are compared modulo 256, the smallest wrap of any HCD frame counter */
+#define ZG01_LINK_FRAME_MASK 0xff
+
+/* Longest plausible gap, in 1 ms frames, between an URB completing and the next one or a timestamp read */
+#define ZG01_LINK_MAX_GAP_MS 64
+
+/* Raw mode: the PCM ring uses the wire frame layout (ten/four 32-bit slots) */
+#define ZG01_RAW_CHANNELS_OUT  10   /* 40-byte playback frame, audio in slots 2-3 */
+#define ZG01_RAW_CHANNELS_IN    4   /* 16-byte capture frame, audio in slots 0-1 */
+
+static bool raw_mode;
+module_param(raw_mode, bool, 0444);
+MODULE_PARM_DESC(raw_mode, "Expose the wire frame as 10-channel playback / 4-channel capture S32_LE PCMs");
+
+/* Playback audio is packed one URB queue ahead of the wire; fewer URBs = lower sidetone latency */
+static unsigned int nr_playback_urbs = MAX_URBS_PER_CHANNEL;
+module_param(nr_playback_urbs, uint, 0444);
+MODULE_PARM_DESC(nr_playback_urbs, "Playback URBs in flight, 4 ms each (2-16, default 16)");
+
+/* Voice In keeps streaming into a pre-roll ring between captures (0 = off) */
+static unsigned int preroll_ms;
+module_param(preroll_ms, uint, 0444);
+MODULE_PARM_DESC(preroll_ms, "Keep Voice In streaming and start captures up to this many ms in the past (0 = off, max 2000)");
+
+#define ZG01_PREROLL_MAX_MS 2000
+
+/* Sidetone consumers resync when they fall this far behind the producer */
+#define ZG01_SIDETONE_MAX_LAG 384
+
+/* Stream mix frames are delivered this far behind the newest source, so every source has added them */
+#define ZG01_MIX_SLACK 384
+
+/* Rate of the 6-frames-per-packet wire geometry; the pre-roll ring and the stream mix run at it */
+#define ZG01_PKT_RATE 48000
+
+/* Voice In rate some firmwares run the clock at */
+#define ZG01_VOICE_LOW_RATE 16000
+
+/* Stream mix PCM device number, clear of the three channel PCMs of the single-card topology */
+#define ZG01_MIX_PCM_DEVICE 3
+
+/* PCM frame size relative to stereo S32_LE (raw frames carry every wire slot) */
+static inline unsigned int zg01_frame_scale(struct zg01_dev *dev)
+{
+    if (!raw_mode)
+        return 1;
+    return dev->channel_type == CHANNEL_TYPE_VOICE_IN ?
+           ZG01_RAW_CHANNELS_IN / 2 : ZG01_RAW_CHANNELS_OUT / 2;
+}
+
+/* Channel maps: raw slots other than the stereo pair are left unknown */
+static const struct snd_pcm_chmap_elem zg01_chmaps_stereo[] = {
+    { .channels = 2, .map = { SNDRV_CHMAP_FL, SNDRV_CHMAP_FR } },
+    { }
+};
+
+static const struct snd_pcm_chmap_elem zg01_chmaps_raw_out[] = {
+    { .channels = ZG01_RAW_CHANNELS_OUT,
+      .map = { SNDRV_CHMAP_UNKNOWN, SNDRV_CHMAP_UNKNOWN, SNDRV_CHMAP_FL, SNDRV_CHMAP_FR,
+               SNDRV_CHMAP_UNKNOWN, SNDRV_CHMAP_UNKNOWN, SNDRV_CHMAP_UNKNOWN,
+               SNDRV_CHMAP_UNKNOWN, SNDRV_CHMAP_UNKNOWN, SNDRV_CHMAP_UNKNOWN } },
+    { }
+};
+
+static const struct snd_pcm_chmap_elem zg01_chmaps_raw_in[] = {
+    { .channels = ZG01_RAW_CHANNELS_IN,
+      .map = { SNDRV_CHMAP_FL, SNDRV_CHMAP_FR, SNDRV_CHMAP_UNKNOWN, SNDRV_CHMAP_UNKNOWN } },
+    { }
+};
+
+/* Gain for frame n of an URB: linear ramp from start to end over the URB */
+static inline u32 zg01_ramp_gain(u32 start, u32 end, s32 step, unsigned int n, unsigned int frames)
+{
+    return n >= frames ? end : (u32)((s32)start + step * (s32)n);
+}
+
+static inline int32_t zg01_apply_gain(int32_t sample, u32 gain)
+{
+    return (int32_t)(((s64)sample * gain) >> ZG01_GAIN_SHIFT);
+}
+
+static inline int32_t zg01_mix_sat(int32_t a, int32_t b)
+{
+    return (int32_t)clamp_t(s64, (s64)a + b, S32_MIN, S32_MAX);
+}
+
+/* Level meter accumulation: peak magnitude and sum of squares of the upper 16 bits */
+static inline void zg01_meter_sample(int32_t sample, u32 *peak, u64 *sumsq)
+{
+    u32 mag = sample < 0 ? (u32)-(s64)sample : (u32)sample;
+    s32 hi = sample >> 16;
+
+    if (mag > *peak)
+        *peak = mag;
+    *sumsq += (u64)((s64)hi * hi);
+}
+
+/* PCM formats converted to and from the wire's 32-bit slots in the pack/unpack loops */
+#define ZG01_PCM_FORMATS (SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_3LE | \
+                          SNDRV_PCM_FMTBIT_S24_LE | SNDRV_PCM_FMTBIT_S32_LE)
+
+/* Read one ring sample, left-justified to 32 bits like the wire slot */
+static inline int32_t zg01_sample_read(const unsigned char *p, snd_pcm_format_t format)
+{
+    switch (format) {
+    case SNDRV_PCM_FORMAT_S16_LE:
+        return (int32_t)((u32)p[0] << 16 | (u32)p[1] << 24);
+    case SNDRV_PCM_FORMAT_S24_3LE:
+        return (int32_t)((u32)p[0] << 8 | (u32)p[1] << 16 | (u32)p[2] << 24);
+    case SNDRV_PCM_FORMAT_S24_LE:
+        return (int32_t)((u32)p[0] << 8 | (u32)p[1] << 16 | (u32)p[2] << 24);
+    default:
+        return (int32_t)((u32)p[0] | (u32)p[1] << 8 | (u32)p[2] << 16 | (u32)p[3] << 24);
+    }
+}
+
+/* Write one wire slot to the ring, truncated to the PCM format */
+static inline void zg01_sample_write(unsigned char *p, int32_t sample, snd_pcm_format_t format)
+{
+    u32 v = (u32)sample;
+
+    switch (format) {
+    case SNDRV_PCM_FORMAT_S16_LE:
+        p[0] = v >> 16;
+        p[1] = v >> 24;
+        break;
+    case SNDRV_PCM_FORMAT_S24_3LE:
+        p[0] = v >> 8;
+        p[1] = v >> 16;
+        p[2] = v >> 24;
+        break;
+    case SNDRV_PCM_FORMAT_S24_LE:
+        /* 24 bits in the low three bytes, sign-extended */
+        p[0] = v >> 8;
+        p[1] = v >> 16;
+        p[2] = v >> 24;
+        p[3] = (sample < 0) ? 0xff : 0x00;
+        break;
+    default:
+        p[0] = v;
+        p[1] = v >> 8;
+        p[2] = v >> 16;
+        p[3] = v >> 24;
+        break;
+    }
+}
+
+/* Copy between the PCM ring and a linear span, wrapping at the end of the ring */
+static inline void zg01_ring_read(const unsigned char *ring, unsigned int ring_bytes,
+                                  unsigned int pos, unsigned char *dst, unsigned int len)
+{
+    unsigned int first = min(len, ring_bytes - pos);
+
+    memcpy(dst, ring + pos, first);
+    if (len > first)
+        memcpy(dst + first, ring, len - first);
+}
+
+static inline void zg01_ring_write(unsigned char *ring, unsigned int ring_bytes,
+                                   unsigned int pos, const unsigned char *src, unsigned int len)
+{
+    unsigned int first = min(len, ring_bytes - pos);
+
+    memcpy(ring + pos, src, first);
+    if (len > first)
+        memcpy(ring, src + first, len - first);
+}
 
 /* Helper function to get active URB count based on channel type */
 static inline int zg01_get_active_urbs_count(struct zg01_dev *dev)
@@ -48,11 +226,72 @@ static inline int zg01_get_active_urbs_count(struct zg01_dev *dev)
 }
 
 
+/*
+ * Rates this stream can offer: the clock source's rates (UAC2 RANGE, read
+ * at bring-up) that the channel can pack, ascending. Game and Voice Out
+ * pack 6 frames per packet, so they need 48 kHz; Voice In also takes the
+ * 16 kHz some firmwares run at. Falls back to that set before bring-up.
+ */
+static void zg01_channel_rates(struct zg01_dev *dev)
+{
+    struct zg01_shared *sh = dev->shared;
+    unsigned int nr = READ_ONCE(sh->nr_rates);
+    unsigned int i;
+
+    dev->nr_rates = 0;
+    if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
+        for (i = 0; i < nr; i++)
+            if (sh->rates[i] == ZG01_VOICE_LOW_RATE)
+                dev->rate_list[dev->nr_rates++] = ZG01_VOICE_LOW_RATE;
+    }
+    for (i = 0; i < nr; i++)
+        if (sh->rates[i] == ZG01_PKT_RATE)
+            dev->rate_list[dev->nr_rates++] = ZG01_PKT_RATE;
+
+    if (!dev->nr_rates) {
+        if (dev->channel_type == CHANNEL_TYPE_VOICE_IN && !nr)
+            dev->rate_list[dev->nr_rates++] = ZG01_VOICE_LOW_RATE;
+        dev->rate_list[dev->nr_rates++] = ZG01_PKT_RATE;
+    }
+}
+
+/* Whether @rate is one the open stream's hw rule offers */
+static bool zg01_rate_listed(struct zg01_dev *dev, unsigned int rate)
+{
+    unsigned int i;
+
+    for (i = 0; i < dev->nr_rates; i++)
+        if (dev->rate_list[i] == rate)
+            return true;
+    return false;
+}
+
+/*
+ * Offer the precomputed rates, narrowed to the running clock when other
+ * armed streams pin it, so negotiation settles on a rate prepare can set
+ * instead of hw_params failing and the client retrying.
+ */
+static int zg01_hw_rule_rate(struct snd_pcm_hw_params *params, struct snd_pcm_hw_rule *rule)
+{
+    struct zg01_dev *dev = rule->private;
+    struct snd_interval *it = hw_param_interval(params, SNDRV_PCM_HW_PARAM_RATE);
+    unsigned int locked = zg01_shared_locked_rate(dev->shared, dev->armed);
+    unsigned int i;
+
+    if (locked) {
+        for (i = 0; i < dev->nr_rates; i++)
+            if (dev->rate_list[i] == locked)
+                return snd_interval_list(it, 1, &locked, 0);
+    }
+    return snd_interval_list(it, dev->nr_rates, dev->rate_list, 0);
+}
+
 static int zg01_pcm_open(struct snd_pcm_substream *substream)
 {
     struct zg01_dev *dev = snd_pcm_substream_chip(substream);
     struct snd_pcm_runtime *runtime = substream->runtime;
     int ret = 0;
+    bool claimed = false;
     unsigned long now = jiffies;
     
     if (!dev) {
@@ -86,6 +325,13 @@ static int zg01_pcm_open(struct snd_pcm_substream *substream)
         }
     }
     
+    /* Keep the device out of autosuspend while the stream is open */
+    if (!dev->interface)
+        return -ENODEV;
+    ret = usb_autopm_get_interface(dev->interface);
+    if (ret < 0)
+        return ret;
+
     /* Protect concurrent opens */
     mutex_lock(&dev->pcm_mutex);
     
@@ -102,15 +348,19 @@ static int zg01_pcm_open(struct snd_pcm_substream *substream)
     dev->last_open_jiffies = now;
     
     runtime->hw.info = SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_INTERLEAVED |
-                       SNDRV_PCM_INFO_BLOCK_TRANSFER;
-
-    runtime->hw.formats = SNDRV_PCM_FMTBIT_S32_LE;  /* 32-bit samples (device uses lower 24 bits) */
-        /* Default to 48kHz; voice channel may operate at 16kHz on some devices */
-        runtime->hw.rates = SNDRV_PCM_RATE_48000;
-    runtime->hw.rate_min = 48000;
-    runtime->hw.rate_max = 48000;
-    runtime->hw.channels_min = 2;
-    runtime->hw.channels_max = 2;
+                       SNDRV_PCM_INFO_BLOCK_TRANSFER | SNDRV_PCM_INFO_SYNC_START |
+                       SNDRV_PCM_INFO_HAS_LINK_ATIME | SNDRV_PCM_INFO_HAS_LINK_SYNCHRONIZED_ATIME |
+                       SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
+
+    /* Raw mode exposes the wire slots as-is; otherwise the packer converts */
+    runtime->hw.formats = raw_mode ? SNDRV_PCM_FMTBIT_S32_LE : ZG01_PCM_FORMATS;
+    /* Rates come from the clock source, see zg01_channel_rates() */
+    zg01_channel_rates(dev);
+    runtime->hw.rates = SNDRV_PCM_RATE_KNOT;
+    runtime->hw.rate_min = dev->rate_list[0];
+    runtime->hw.rate_max = dev->rate_list[dev->nr_rates - 1];
+    runtime->hw.channels_min = 2 * zg01_frame_scale(dev);
+    runtime->hw.channels_max = 2 * zg01_frame_scale(dev);
 
     /* Configure buffer sizes based on channel type */
     if (dev->channel_type == CHANNEL_TYPE_GAME) {
@@ -142,20 +392,21 @@ static int zg01_pcm_open(struct snd_pcm_substream *substream)
         }
 
         /* Ensure we have a valid usb_device before changing interface */
-        if (!dev->udev) {
+        if (!dev->udev || !dev->shared) {
             pr_err("zg01_pcm: No usb_device available to set interface\n");
             ret = -ENODEV;
             goto unlock;
         }
 
-        /* Set Interface 1 to Alt Setting 1 to enable isochronous endpoint 0x01 OUT */
-        ret = usb_set_interface(dev->udev, 1, 1);
+        /* Claim Interface 1 (Alt 1, isochronous endpoint 0x01 OUT, is set at prepare) */
+        ret = zg01_shared_iface_get(dev->shared, 1);
         if (ret < 0) {
-            pr_err("zg01_pcm: Failed to set Interface 1 Alt 1: %d\n", ret);
+            pr_err("zg01_pcm: Failed to claim Interface 1: %d\n", ret);
             goto unlock;
         }
+        claimed = true;
         if (!is_rapid_probe) {
-            pr_info("zg01_pcm: Game channel configured Interface 1, Alt 1, EP 0x01 OUT (280 bytes)\n");
+            pr_info("zg01_pcm: Game channel claimed Interface 1, Alt 1, EP 0x01 OUT (280 bytes)\n");
         }
     } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
         /* Voice In channel - Interface 2, Alt 1, EP 0x81 IN (124 bytes) - CAPTURE ONLY */
@@ -163,10 +414,6 @@ static int zg01_pcm_open(struct snd_pcm_substream *substream)
         runtime->hw.buffer_bytes_max = PCM_BUFFER_BYTES_MAX_VOICE;
         runtime->hw.period_bytes_min = PCM_PERIOD_BYTES_MIN_VOICE;
         runtime->hw.period_bytes_max = PCM_PERIOD_BYTES_MAX_VOICE;
-        /* Voice channel can be 16kHz or 48kHz depending on device firmware; allow both */
-        runtime->hw.rates = SNDRV_PCM_RATE_48000 | SNDRV_PCM_RATE_16000;
-        runtime->hw.rate_min = 16000;
-        runtime->hw.rate_max = 48000;
         if (!is_rapid_probe) {
             pr_info("zg01_pcm: Opening ZG01 Voice In channel (Interface 2, Alt 1)\n");
         } else {
@@ -190,20 +437,21 @@ static int zg01_pcm_open(struct snd_pcm_substream *substream)
         }
 
         /* Ensure we have a valid usb_device before changing interface */
-        if (!dev->udev) {
+        if (!dev->udev || !dev->shared) {
             pr_err("zg01_pcm: No usb_device available to set interface\n");
             ret = -ENODEV;
             goto unlock;
         }
 
-        /* Set Interface 2 to Alt Setting 1 to enable isochronous endpoint 0x81 IN */
-        ret = usb_set_interface(dev->udev, 2, 1);
+        /* Claim Interface 2 (Alt 1, isochronous endpoint 0x81 IN, is set at prepare) */
+        ret = zg01_shared_iface_get(dev->shared, 2);
         if (ret < 0) {
-            pr_err("zg01_pcm: Failed to set Interface 2 Alt 1: %d\n", ret);
+            pr_err("zg01_pcm: Failed to claim Interface 2: %d\n", ret);
             goto unlock;
         }
+        claimed = true;
         if (!is_rapid_probe) {
-            pr_info("zg01_pcm: Voice In channel configured Interface 2, Alt 1, EP 0x81 IN (124 bytes)\n");
+            pr_info("zg01_pcm: Voice In channel claimed Interface 2, Alt 1, EP 0x81 IN (124 bytes)\n");
         }
     } else {
         /* Voice Out channel - Interface 1, Alt 1, EP 0x01 OUT - PLAYBACK ONLY */
@@ -234,59 +482,67 @@ static int zg01_pcm_open(struct snd_pcm_substream *substream)
         }
 
         /* Ensure we have a valid usb_device before changing interface */
-        if (!dev->udev) {
+        if (!dev->udev || !dev->shared) {
             pr_err("zg01_pcm: No usb_device available to set interface\n");
             ret = -ENODEV;
             goto unlock;
         }
 
-        /* According to USB capture: Interface 2 Alt 0, then Interface 1 Alt 1, then Interface 2 Alt 1 */
-        ret = usb_set_interface(dev->udev, 2, 0);
-        if (ret < 0) {
-            pr_warn("zg01_pcm: Failed to set Interface 2 Alt 0 for Voice Out: %d\n", ret);
-        }
-        
-        ret = usb_set_interface(dev->udev, 1, 1);
+        /* According to USB capture: Interface 2 Alt 0, then Interface 1 Alt 1, then Interface 2 Alt 1.
+         * The shared context applies that order when prepare activates Interface 1, only
+         * while no Voice In stream is armed, and leaves it alone if Game already brought it up. */
+        ret = zg01_shared_iface_get(dev->shared, 1);
         if (ret < 0) {
-            pr_err("zg01_pcm: Failed to set Interface 1 Alt 1 for Voice Out: %d\n", ret);
+            pr_err("zg01_pcm: Failed to claim Interface 1 for Voice Out: %d\n", ret);
             goto unlock;
         }
-        
-        ret = usb_set_interface(dev->udev, 2, 1);
-        if (ret < 0) {
-            pr_warn("zg01_pcm: Failed to set Interface 2 Alt 1 for Voice Out: %d\n", ret);
-        }
+        claimed = true;
         
         if (!is_rapid_probe) {
-            pr_info("zg01_pcm: Voice Out channel configured Interface 1, Alt 1, EP 0x01 OUT (voice mode)\n");
+            pr_info("zg01_pcm: Voice Out channel claimed Interface 1, Alt 1, EP 0x01 OUT (voice mode)\n");
         }
     }
     
+    /* Same frame counts as stereo, with raw-mode wire frames */
+    runtime->hw.buffer_bytes_max *= zg01_frame_scale(dev);
+    runtime->hw.period_bytes_min *= zg01_frame_scale(dev);
+    runtime->hw.period_bytes_max *= zg01_frame_scale(dev);
+    /* S16_LE frames are half the size: keep the minimum period in frames */
+    if (!raw_mode)
+        runtime->hw.period_bytes_min /= 2;
+
     runtime->hw.periods_min = 2;
     runtime->hw.periods_max = 64; /* Allow more flexibility for PipeWire */
     
-    /* Add constraints to ensure USB packet alignment */
+    ret = snd_pcm_hw_rule_add(runtime, 0, SNDRV_PCM_HW_PARAM_RATE, zg01_hw_rule_rate, dev,
+                              SNDRV_PCM_HW_PARAM_RATE, -1);
+    if (ret < 0) {
+        pr_err("zg01_pcm: Failed to add rate rule: %d\n", ret);
+        goto unlock;
+    }
+
+    /* Add constraints to ensure USB packet alignment (in frames, so they hold for any sample width) */
     if (dev->channel_type == CHANNEL_TYPE_GAME || dev->channel_type == CHANNEL_TYPE_VOICE_OUT) {
-        /* Game and Voice Out channels: period size must be multiple of 1536 bytes (192 frames = 1 URB) */
-        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_PERIOD_BYTES, 1536);
+        /* Game and Voice Out channels: period size must be multiple of 192 frames (1 URB) */
+        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, 192);
         if (ret < 0) {
             pr_err("zg01_pcm: Failed to set period step constraint: %d\n", ret);
             goto unlock;
         }
         /* Buffer size should also align to period boundaries */
-        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_BUFFER_BYTES, 96);
+        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_BUFFER_SIZE, 12);
         if (ret < 0) {
             pr_err("zg01_pcm: Failed to set buffer step constraint: %d\n", ret);
             goto unlock;
         }
     } else {
-        /* Voice In channel: period size must be multiple of 48 bytes (6 frames) */
-        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_PERIOD_BYTES, 48);
+        /* Voice In channel: period size must be multiple of 6 frames (1 packet) */
+        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_PERIOD_SIZE, 6);
         if (ret < 0) {
             pr_err("zg01_pcm: Failed to set period step constraint: %d\n", ret);
             goto unlock;
         }
-        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_BUFFER_BYTES, 48);
+        ret = snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_BUFFER_SIZE, 6);
         if (ret < 0) {
             pr_err("zg01_pcm: Failed to set buffer step constraint: %d\n", ret);
             goto unlock;
@@ -321,7 +577,15 @@ static int zg01_pcm_open(struct snd_pcm_substream *substream)
     }
 
 unlock:
+    if (claimed) {
+        if (ret < 0)
+            zg01_shared_iface_put(dev->shared, zg01_channel_iface(dev));
+        else
+            dev->iface_claimed = true;
+    }
     mutex_unlock(&dev->pcm_mutex);
+    if (ret < 0)
+        usb_autopm_put_interface(dev->interface);
     return ret;
 }
 
@@ -370,8 +634,18 @@ static int zg01_pcm_close(struct snd_pcm_substream *substream)
             pr_debug("zg01_pcm: Voice Out channel closed (rapid probe)\n");
         }
     }
+
+    /* Release our hold on the shared interface state */
+    zg01_shared_disarm(dev->shared, zg01_channel_iface(dev), &dev->armed);
+    if (dev->iface_claimed) {
+        zg01_shared_iface_put(dev->shared, zg01_channel_iface(dev));
+        dev->iface_claimed = false;
+    }
     
     mutex_unlock(&dev->pcm_mutex);
+
+    /* Autosuspend may kick in once the last stream is closed */
+    usb_autopm_put_interface(dev->interface);
     return 0;
 }
 
@@ -396,49 +670,29 @@ static int zg01_pcm_hw_params(struct snd_pcm_substream *substream,
             params_periods(hw_params),
             params_buffer_size(hw_params));
     
-    /* Validate parameters: device supports 48000 and may report 16000 on some firmwares */
-    if (rate != 48000 && rate != 16000) {
+    /* Validate against the rates the hw rule offered (clock RANGE, narrowed to what the channel packs) */
+    if (!zg01_rate_listed(dev, rate)) {
         pr_warn("zg01_pcm: Unsupported sample rate: %u\n", rate);
         return -EINVAL;
     }
 
-    /* Attempt to read device-reported sampling frequency (GET_CUR) and enforce it.
-     * If we cannot read the device, fall back to accepting the requested rate.
-     */
-    if (dev && dev->udev) {
-        unsigned char cur_rate_buf[4];
-        int rc = usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                                 0x01, /* GET_CUR */
-                                 USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
-                                 0x0100, /* SAMPLING_FREQ_CONTROL */
-                                 0x0100, /* Index: Entity 1, Intf 0 */
-                                 cur_rate_buf, 4, 500);
-        if (rc == 4) {
-            unsigned int dev_rate = cur_rate_buf[0] | (cur_rate_buf[1] << 8) |
-                                    (cur_rate_buf[2] << 16) | (cur_rate_buf[3] << 24);
-            pr_info("zg01_pcm: Device-reported sampling rate via GET_CUR: %u\n", dev_rate);
-            dev->current_rate = (int)dev_rate;
-            if ((unsigned int)dev->current_rate != rate) {
-                pr_warn("zg01_pcm: Requested rate %u does not match device rate %u; rejecting hw_params\n",
-                        rate, dev->current_rate);
-                return -EINVAL;
-            }
-        } else {
-            pr_warn("zg01_pcm: Could not read device sampling rate (rc=%d); accepting requested rate %u\n", rc, rate);
-            dev->current_rate = rate;
-        }
-    } else {
-        /* No usb_device available; accept requested rate and store it */
-        dev->current_rate = rate;
+    /* The rate rule already offered only rates prepare can set; a differing
+     * cached clock rate just means prepare runs the magic sequence again. */
+    if (dev->shared) {
+        unsigned int dev_rate;
+
+        if (zg01_shared_read_rate(dev->shared, &dev_rate) == 0 && dev_rate != rate)
+            pr_debug("zg01_pcm: Clock at %u Hz, switched to %u Hz at prepare\n", dev_rate, rate);
     }
     dev->rate_residual = 0;
     
-    if (channels != 2) {
+    if (channels != 2 * zg01_frame_scale(dev)) {
         pr_warn("zg01_pcm: Unsupported channel count: %u\n", channels);
         return -EINVAL;
     }
     
-    if (format != SNDRV_PCM_FORMAT_S32_LE) {
+    if (format != SNDRV_PCM_FORMAT_S32_LE &&
+        (raw_mode || !(pcm_format_to_bits(format) & ZG01_PCM_FORMATS))) {
         pr_warn("zg01_pcm: Unsupported format: %u\n", format);
         return -EINVAL;
     }
@@ -457,157 +711,11 @@ static int zg01_pcm_hw_params(struct snd_pcm_substream *substream,
 
 static int zg01_pcm_hw_free(struct snd_pcm_substream *substream)
 {
-    return 0;
-}
-
-/* Helper to set sample rate via UAC2 Clock Source Control + Extended Vendor Magic */
-static int zg01_set_rate(struct zg01_dev *dev, int rate)
-{
-    unsigned char *data;
-    unsigned char *large_data;
-    int ret = 0;
-    
-    if (!dev || !dev->udev) {
-        pr_err("zg01_pcm: zg01_set_rate called with invalid dev or missing udev\n");
-        return -ENODEV;
-    }
-
-    /* Allocate DMA-capable buffers - USB control messages need DMA-safe memory */
-    data = kmalloc(4, GFP_KERNEL);
-    large_data = kmalloc(72, GFP_KERNEL);
-    if (!data || !large_data) {
-        pr_err("zg01_pcm: Failed to allocate control message buffers\n");
-        ret = -ENOMEM;
-        goto cleanup;
-    }
-    
-    pr_info("zg01_pcm: Starting extended Magic Sequence for %d Hz\n", rate);
-    
-    /* 1. Early Vendor Reads (Initialization/State discovery) */
-    /* Many Yamaha devices require these reads to move out of standby */
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x07, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x0000, 0x0000, large_data, 3, 1000);
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x04, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x0000, 0x0000, large_data, 1, 1000);
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x0a, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x0000, 0x0000, large_data, 4, 1000);
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x0c, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x8000, 0x0000, large_data, 72, 1000);
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x0c, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x0000, 0x0000, large_data, 72, 1000);
-
-    /* 2. Set Interfaces 1 and 2 to Alt 0 */
-    pr_info("zg01_pcm: Resetting interfaces to Alt 0\n");
-    if (dev->udev) {
-        usb_set_interface(dev->udev, 1, 0);
-        usb_set_interface(dev->udev, 2, 0);
-    } else {
-        pr_warn("zg01_pcm: Skipping interface reset; missing udev\n");
-    }
-
-    /* 3. Set UAC2 Rate on Clock Source 1 */
-    data[0] = rate & 0xff;
-    data[1] = (rate >> 8) & 0xff;
-    data[2] = (rate >> 16) & 0xff;
-    data[3] = (rate >> 24) & 0xff;
-    
-    /* Perform SET_CUR and then verify by reading GET_CUR. Retry if necessary. */
-    {
-        int attempts = 3;
-        int attempt;
-        int verify_ret = -EIO;
-        for (attempt = 1; attempt <= attempts; attempt++) {
-            ret = usb_control_msg(dev->udev, usb_sndctrlpipe(dev->udev, 0),
-                                  0x01, /* SET_CUR (class) */
-                                  USB_DIR_OUT | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
-                                  0x0100, /* SAMPLING_FREQ_CONTROL */
-                                  0x0100, /* Index: Entity 1, Intf 0 */
-                                  data, 4, 1000);
-
-            if (ret < 0) {
-                pr_err("zg01_pcm: Attempt %d: Failed to set UAC2 rate: %d\n", attempt, ret);
-            } else {
-                pr_info("zg01_pcm: Attempt %d: UAC2 Set Rate sent\n", attempt);
-            }
-
-            /* Read back the current sampling frequency (GET_CUR) */
-            verify_ret = usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                                         0x01, /* GET_CUR (class) */
-                                         USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
-                                         0x0100, /* SAMPLING_FREQ_CONTROL */
-                                         0x0100, /* Index: Entity 1, Intf 0 */
-                                         large_data, 4, 1000);
-
-            if (verify_ret == 4) {
-                unsigned int ret_rate = large_data[0] | (large_data[1] << 8) |
-                                         (large_data[2] << 16) | (large_data[3] << 24);
-                pr_info("zg01_pcm: GET_CUR reported rate: %u (requested %d)\n", ret_rate, rate);
-                /* Treat the device-reported rate as authoritative */
-                dev->current_rate = (int)ret_rate;
-                if ((int)ret_rate == rate) {
-                    pr_info("zg01_pcm: Verified device rate %u Hz\n", ret_rate);
-                } else {
-                    pr_warn("zg01_pcm: Device reported different rate (%u) than requested (%d); using device rate\n",
-                            ret_rate, rate);
-                }
-                ret = 0;
-                break;
-            } else {
-                pr_warn("zg01_pcm: Failed to read back sampling freq (rc=%d)\n", verify_ret);
-                ret = (verify_ret < 0) ? verify_ret : -EIO;
-            }
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
 
-            /* Try some vendor handshakes if first attempt failed */
-            if (attempt < attempts) {
-                pr_info("zg01_pcm: Retrying rate set (attempt %d/%d)\n", attempt + 1, attempts);
-                /* Small pause to let device settle */
-                msleep(150);
-            }
-        }
-    }
-    
-    /* 4. Complete Handshake/Commit */
-    pr_info("zg01_pcm: Finalizing handshake (Vendor 0xC0/0x41)\n");
-    
-    /* 0xC0 Request 2 Value 2 Index 0 Len 1 */
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x02, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x0002, 0x0000, large_data, 1, 1000);
-                    
-    /* 0xC0 Request 2 Value 1 Index 0 Len 1 */
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x02, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x0001, 0x0000, large_data, 1, 1000);
-                    
-    /* 0xC0 Request 8 Value 0 Index 0 Len 1 */
-    usb_control_msg(dev->udev, usb_rcvctrlpipe(dev->udev, 0),
-                    0x08, USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE,
-                    0x0000, 0x0000, large_data, 1, 1000);
-                    
-    /* 0x41 Request 0 Value 0 Index 0 Len 0 */
-    usb_control_msg(dev->udev, usb_sndctrlpipe(dev->udev, 0),
-                    0x00, /* Request 0 */
-                    USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_INTERFACE,
-                    0x0000, 0x0000, NULL, 0, 1000);
-
-    /* 5. Restore Streaming Interfaces (Alt 1) */
-    pr_info("zg01_pcm: Activating interfaces (Alt 1)\n");
-    usb_set_interface(dev->udev, 1, 1);
-    usb_set_interface(dev->udev, 2, 1);
-    
-    /* Give device time to stabilize after configuration */
-    msleep(200);  /* Increase delay - localhost may need more time */
-    pr_info("zg01_pcm: Magic Sequence complete, device should be ready\n");
-    
-cleanup:
-    kfree(large_data);
-    kfree(data);
-    return ret;
+    if (dev && dev->shared)
+        zg01_shared_disarm(dev->shared, zg01_channel_iface(dev), &dev->armed);
+    return 0;
 }
 
 /* Removed unused zg01_check_clock_validity function - was returning -11 on localhost
@@ -616,103 +724,50 @@ cleanup:
 static int zg01_pcm_prepare(struct snd_pcm_substream *substream)
 {
     struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    struct snd_pcm_runtime *runtime = substream->runtime;
     int ret = 0;
-    int interface_num;
-    int active_urbs_count;
-    bool is_first_prepare = false;
-    
-    /* Determine interface number based on channel type */
-    if (dev->channel_type == CHANNEL_TYPE_GAME || dev->channel_type == CHANNEL_TYPE_VOICE_OUT) {
-        interface_num = 1; /* Game and Voice Out use Interface 1 */
-    } else {
-        interface_num = 2; /* Voice In uses Interface 2 */
-    }
+    int interface_num = zg01_channel_iface(dev);
     
-    pr_info("zg01_pcm: prepare called - channel_type=%d, game_init=%d, voice_init=%d, voice_out_init=%d\n",
-            dev->channel_type, dev->game_initialized, dev->voice_initialized, dev->voice_out_initialized);
+    pr_info("zg01_pcm: prepare called - channel_type=%d, rate=%u, clock_configured=%d (%u Hz)\n",
+            dev->channel_type, runtime->rate, dev->shared->clock_configured, dev->shared->rate);
     
-    /* Check if this is the first prepare (device needs initialization) */
-    if (dev->channel_type == CHANNEL_TYPE_GAME) {
-        /* Game channel */
-        if (!dev->game_initialized) {
-            is_first_prepare = true;
-            dev->game_initialized = true;
-        }
-    } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
-        /* Voice In channel */
-        if (!dev->voice_initialized) {
-            is_first_prepare = true;
-            dev->voice_initialized = true;
+    /* The clock belongs to the shared context: the magic sequence runs once for
+     * the whole device and is skipped when the clock already runs at this rate,
+     * so a second channel starting up never resets interfaces under a running one. */
+    if (dev->channel_type != CHANNEL_TYPE_VOICE_OUT) {
+        ret = zg01_shared_set_rate(dev->shared, runtime->rate, dev->armed);
+        if (ret == -EBUSY) {
+            return ret;
+        } else if (ret < 0) {
+            /* The rate came from the clock's own RANGE; the device has been seen
+             * streaming with this SET_CUR failing, so carry on at its clock */
+            pr_warn("zg01_pcm: Clock setup for %u Hz failed: %d\n", runtime->rate, ret);
         }
     } else {
-        /* Voice Out channel */
-        if (!dev->voice_out_initialized) {
-            is_first_prepare = true;
-            dev->voice_out_initialized = true;
-        }
+        /* Voice Out does NOT send SET_CUR control message according to USB capture;
+         * the interface ordering it needs is applied when it claims Interface 1 */
+        pr_debug("zg01_pcm: Voice Out - skipping sample rate control (not needed per USB capture)\n");
     }
-    
-    /* Only do full initialization on first prepare */
-    if (is_first_prepare) {
-        const char *channel_name;
-        if (dev->channel_type == CHANNEL_TYPE_GAME) channel_name = "Game";
-        else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) channel_name = "Voice In";
-        else channel_name = "Voice Out";
-        
-        pr_info("zg01_pcm: First prepare for %s channel - running initialization\n", channel_name);
-
-        /* Voice Out does NOT send SET_CUR control message according to USB capture */
-        if (dev->channel_type != 2) {
-            /* Game and Voice In: Prefer previously negotiated rate if available, otherwise request 48000 */
-            if (dev->current_rate == 16000 || dev->current_rate == 48000) {
-                pr_info("zg01_pcm: Using existing current_rate=%d\n", dev->current_rate);
-                /* Attempt to set device to current_rate to make sure device matches runtime */
-                if (zg01_set_rate(dev, dev->current_rate) < 0) {
-                    pr_warn("zg01_pcm: zg01_set_rate failed for current_rate=%d, falling back to 48000\n", dev->current_rate);
-                    zg01_set_rate(dev, 48000);
-                    dev->current_rate = 48000;
-                }
-            } else {
-                /* Set Rate with Magic Sequence, default to 48000 */
-                if (zg01_set_rate(dev, 48000) < 0) {
-                    pr_warn("zg01_pcm: zg01_set_rate(48000) failed during initialization\n");
-                } else {
-                    dev->current_rate = 48000;
-                }
-            }
-        } else {
-            /* Voice Out: Skip sample rate setting, just configure interfaces */
-            pr_info("zg01_pcm: Voice Out - skipping sample rate control (not needed per USB capture)\n");
-            /* Set the interface sequence as shown in USB capture: Interface 2 Alt 0, Interface 1 Alt 1, Interface 2 Alt 1 */
-            usb_set_interface(dev->udev, 2, 0);
-            usb_set_interface(dev->udev, 1, 1);
-            usb_set_interface(dev->udev, 2, 1);
-            dev->current_rate = 48000; /* Assume 48kHz */
-        }
 
-        /* Skip clock validity check for now - it fails with -11 on localhost */
-        /* zg01_check_clock_validity(dev); */
-    } else {
-        pr_info("zg01_pcm: prepare called - device already initialized, skipping Magic Sequence\n");
-    }
+    /* Skip clock validity check for now - it fails with -11 on localhost */
+    /* zg01_check_clock_validity(dev); */
     
-    /* Restore streaming interface only if not already streaming */
-    active_urbs_count = zg01_get_active_urbs_count(dev);
-    
-    if (active_urbs_count == 0) {
-        /* Only set interface if not already streaming - avoid disrupting active URBs */
-        pr_debug("zg01_pcm: Switching Interface %d to Alt 1 for streaming\n", interface_num);
-        ret = usb_set_interface(dev->udev, interface_num, 1);
-        if (ret < 0) {
-            pr_err("zg01_pcm: Failed to set Interface %d Alt 1: %d\n", interface_num, ret);
-            return ret;
-        }
-    } else {
-        pr_debug("zg01_pcm: Streaming already active, skipping interface setup\n");
+    /* Mark this stream armed; its interface is brought to Alt 1 if nobody else holds it */
+    ret = zg01_shared_arm(dev->shared, interface_num, &dev->armed);
+    if (ret < 0) {
+        pr_err("zg01_pcm: Failed to set Interface %d Alt 1: %d\n", interface_num, ret);
+        return ret;
+    }
+
+    /* URBs are allocated here; trigger runs atomic and only submits them */
+    ret = zg01_alloc_streaming(dev);
+    if (ret < 0) {
+        pr_err("zg01_pcm: Failed to prepare URBs: %d\n", ret);
+        return ret;
     }
     
-    /* Reset PCM position only if not already streaming */
-    if (zg01_get_active_urbs_count(dev) == 0) {
+    /* Reset PCM position only if not already streaming (pre-roll URBs carry no stream) */
+    if (zg01_get_active_urbs_count(dev) == 0 || dev->preroll_armed) {
         if (dev->channel_type == CHANNEL_TYPE_GAME) {
             dev->pcm_pos_game = 0;
         } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
@@ -801,6 +856,276 @@ static void zg01_cleanup_multi_urb_work_fn(struct work_struct *work)
     kfree(cw);
 }
 
+/*
+ * log2 of urb->start_frame units per 1 ms bus frame. For high-speed
+ * endpoints both EHCI and xHCI take and report microframes there, while
+ * usb_get_current_frame_number() returns 1 ms frames on either.
+ */
+static unsigned int zg01_frame_shift(struct zg01_dev *dev)
+{
+    return dev->udev->speed == USB_SPEED_HIGH ? 3 : 0;
+}
+
+/*
+ * Stream mix ring position of the first frame of an URB: 48 frames per bus
+ * frame, plus 6 per microframe into it, so streams starting in different
+ * microframes of one frame land at their own offsets.
+ */
+static inline unsigned int zg01_mix_urb_pos(struct zg01_dev *dev, struct urb *urb)
+{
+    unsigned int shift = zg01_frame_shift(dev);
+    unsigned int frame = urb->start_frame;
+
+    return ((frame >> shift) % ZG01_MIX_MS) * 48 + (frame & ((1U << shift) - 1)) * (48 >> shift);
+}
+
+/*
+ * Link time bookkeeping, called with dev->lock held for every completed URB:
+ * advance a stream's link clock (@link_frame, @link_ms) to the bus frame
+ * the URB started on.
+ * Frame counters wrap at 256 frames or a multiple of it on every HCD, and
+ * consecutive completions are far less than 256 ms apart. A gap out of
+ * range means the frame numbers are not what we think they are: advance
+ * by one URB instead and say so once.
+ */
+static void zg01_link_advance(struct zg01_dev *dev, struct urb *urb,
+                              int *link_frame, unsigned int *link_ms)
+{
+    unsigned int shift = zg01_frame_shift(dev);
+    int frame = ((unsigned int)urb->start_frame >> shift) & ZG01_LINK_FRAME_MASK;
+    unsigned int gap;
+
+    if (*link_frame < 0) {
+        *link_ms = 0;
+    } else {
+        gap = (frame - *link_frame) & ZG01_LINK_FRAME_MASK;
+        if (!gap || gap > ZG01_LINK_MAX_GAP_MS) {
+            pr_warn_once("zg01_pcm: URB start frames %d -> %d out of sequence, link time resynced\n",
+                         *link_frame, frame);
+            gap = max(urb->number_of_packets >> shift, 1U);
+        }
+        *link_ms += gap;
+    }
+    *link_frame = frame;
+}
+
+/* Signed distance a - b on the stream mix ring */
+static inline int zg01_mix_dist(unsigned int a, unsigned int b)
+{
+    int d = (a + ZG01_MIX_FRAMES - b) % ZG01_MIX_FRAMES;
+
+    return d >= ZG01_MIX_FRAMES / 2 ? d - ZG01_MIX_FRAMES : d;
+}
+
+/* Add frames of one source at ring position pos; frames already delivered are dropped */
+static void zg01_mix_add(struct zg01_mix *mix, int src, unsigned int pos,
+                         const s32 (*pairs)[2], unsigned int n)
+{
+    unsigned long flags;
+    unsigned int k;
+    u32 gain;
+
+    spin_lock_irqsave(&mix->lock, flags);
+    gain = mix->gain[src];
+    if (mix->running && mix->synced && gain) {
+        for (k = 0; k < n; k++) {
+            unsigned int p = (pos + k) % ZG01_MIX_FRAMES;
+
+            if (zg01_mix_dist(p, mix->read) < 0)
+                continue;
+            mix->buf[p][0] = zg01_mix_sat(mix->buf[p][0], zg01_apply_gain(pairs[k][0], gain));
+            mix->buf[p][1] = zg01_mix_sat(mix->buf[p][1], zg01_apply_gain(pairs[k][1], gain));
+        }
+    }
+    spin_unlock_irqrestore(&mix->lock, flags);
+}
+
+/*
+ * A source finished an URB ending at ring position end: hand everything up
+ * to ZG01_MIX_SLACK frames before it to the capture PCM and clear it for
+ * the next lap. The first call after start places the read position.
+ */
+static void zg01_mix_advance(struct zg01_mix *mix, unsigned int end)
+{
+    struct snd_pcm_substream *ms = NULL;
+    struct snd_pcm_runtime *mr;
+    unsigned int target = (end + ZG01_MIX_FRAMES - ZG01_MIX_SLACK) % ZG01_MIX_FRAMES;
+    unsigned long flags;
+    bool elapsed = false;
+    int todo;
+
+    spin_lock_irqsave(&mix->lock, flags);
+    if (!mix->running || !mix->substream || !mix->substream->runtime ||
+        !mix->substream->runtime->dma_area)
+        goto out;
+
+    if (!mix->synced) {
+        mix->read = target;
+        mix->synced = true;
+        goto out;
+    }
+
+    todo = zg01_mix_dist(target, mix->read);
+    if (todo <= 0)
+        goto out;
+    if (todo > ZG01_MIX_FRAMES / 4) {
+        /* Lost track of the bus timeline (stall, frame counter jump): resync */
+        mix->read = target;
+        goto out;
+    }
+
+    ms = mix->substream;
+    mr = ms->runtime;
+    while (todo--) {
+        unsigned char *dst = mr->dma_area + (mix->pos % mr->buffer_size) * 8;
+
+        memcpy(dst, mix->buf[mix->read], 8);
+        memset(mix->buf[mix->read], 0, 8);
+        mix->read = (mix->read + 1) % ZG01_MIX_FRAMES;
+        mix->pos++;
+        if (mr->period_size && mix->pos % mr->period_size == 0 && !mr->no_period_wakeup)
+            elapsed = true;
+    }
+out:
+    spin_unlock_irqrestore(&mix->lock, flags);
+
+    if (elapsed)
+        snd_pcm_period_elapsed(ms);
+}
+
+/*
+ * Taps on a playback URB that has just gone out: the echo reference and
+ * the stream mix both get the stereo pair the device was actually sent.
+ * Running on completion means each frame comes with the bus frame it was
+ * sent on (the Voice In timeline) and the data is exactly what the device
+ * got. Raw and routed layouts are followed by taking the lowest slot of
+ * each channel's route.
+ */
+static void zg01_playback_tap(struct zg01_dev *dev, struct urb *urb)
+{
+    struct zg01_mix *mix = &dev->shared->mix;
+    struct snd_pcm_substream *es;
+    struct snd_pcm_runtime *er = NULL;
+    unsigned int slot_l, slot_r, pos, base;
+    unsigned long flags;
+    bool elapsed = false, mixing;
+    s32 pairs[6][2];
+    int i, f;
+
+    base = zg01_mix_urb_pos(dev, urb);
+    mixing = READ_ONCE(mix->running);
+
+    spin_lock_irqsave(&dev->lock, flags);
+    es = dev->echo_substream;
+    if (es && dev->echo_running && es->runtime && es->runtime->dma_area)
+        er = es->runtime;
+    if (!er && !mixing)
+        goto out;
+    slot_l = dev->control.route_mask[0] ? ffs(dev->control.route_mask[0]) - 1 : 2;
+    slot_r = dev->control.route_mask[1] ? ffs(dev->control.route_mask[1]) - 1 : 3;
+
+    pos = dev->echo_pos;
+    for (i = 0; i < urb->number_of_packets; i++) {
+        unsigned char *pkt_buf = urb->transfer_buffer + urb->iso_frame_desc[i].offset;
+
+        if (urb->iso_frame_desc[i].length != 240)
+            continue;
+        for (f = 0; f < 6; f++) {
+            unsigned char *wire = pkt_buf + f * 40;
+
+            memcpy(&pairs[f][0], wire + slot_l * 4, 4);
+            memcpy(&pairs[f][1], wire + slot_r * 4, 4);
+            if (er) {
+                memcpy(er->dma_area + (pos % er->buffer_size) * 8, pairs[f], 8);
+                pos++;
+            }
+        }
+        if (mixing)
+            zg01_mix_add(mix, dev->channel_type, base + i * 6, pairs, 6);
+    }
+    if (er) {
+        elapsed = er->period_size && pos / er->period_size != dev->echo_pos / er->period_size &&
+                  !er->no_period_wakeup;
+        dev->echo_pos = pos;
+        zg01_link_advance(dev, urb, &dev->echo_link_frame, &dev->echo_link_ms);
+    }
+out:
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    if (elapsed)
+        snd_pcm_period_elapsed(es);
+    zg01_mix_advance(mix, base + urb->number_of_packets * 6);
+}
+
+/* Most frames a Voice In packet may carry (96 kHz, 12 per microframe) */
+#define ZG01_CAPTURE_MAX_PKT_FRAMES 12
+
+/*
+ * Frames in a Voice In packet of @len bytes: an 8-byte header, 16-byte
+ * frames and a 4-byte trailer (108 bytes for the six frames of 48 kHz).
+ * The count follows the rate and the firmware, so it is taken from the
+ * length rather than assumed. 0 for a runt or malformed packet.
+ */
+static inline unsigned int zg01_capture_pkt_frames(unsigned int len)
+{
+    if (len < 12 + 16 || (len - 12) % 16 || (len - 12) / 16 > ZG01_CAPTURE_MAX_PKT_FRAMES)
+        return 0;
+    return (len - 12) / 16;
+}
+
+/* Append the frames of a completed Voice In URB to the pre-roll ring. Caller holds dev->lock. */
+static unsigned int zg01_preroll_feed(struct zg01_preroll *pr, struct urb *urb)
+{
+    unsigned int fed = 0;
+    int i, f;
+
+    for (i = 0; i < urb->number_of_packets; i++) {
+        unsigned char *pkt_buf = urb->transfer_buffer + urb->iso_frame_desc[i].offset;
+        unsigned int n = zg01_capture_pkt_frames(urb->iso_frame_desc[i].actual_length);
+
+        for (f = 0; f < n; f++) {
+            memcpy(pr->buf[pr->head], pkt_buf + 8 + f * 16, 8);
+            pr->head = (pr->head + 1) % pr->frames;
+        }
+        fed += n;
+    }
+    pr->filled = min(pr->filled + fed, pr->frames);
+    return fed;
+}
+
+/*
+ * First URB of a capture started over a running pre-roll: copy the ring,
+ * minus the @fed frames of this URB that the unpacker is about to write,
+ * into the DMA buffer. Caller holds dev->lock. Returns true on a period boundary.
+ */
+static bool zg01_preroll_load(struct zg01_preroll *pr, struct snd_pcm_runtime *runtime,
+                              unsigned int *pcm_pos, unsigned int fed)
+{
+    unsigned int bytes_per_frame = runtime->frame_bits / 8;
+    unsigned int n, src, dst, k;
+
+    pr->pending = false;
+    if (runtime->rate != ZG01_PKT_RATE || pr->filled <= fed)
+        return false;
+
+    /* Leave a period of room so the capture does not start in overrun */
+    n = min_t(unsigned int, pr->filled - fed, runtime->buffer_size - runtime->period_size);
+    n -= n % 6;
+    src = (pr->head + pr->frames - fed - n) % pr->frames;
+    dst = *pcm_pos % runtime->buffer_size;
+    for (k = 0; k < n; k++) {
+        unsigned char *p = runtime->dma_area + dst * bytes_per_frame;
+
+        zg01_sample_write(p, pr->buf[src][0], runtime->format);
+        zg01_sample_write(p + bytes_per_frame / 2, pr->buf[src][1], runtime->format);
+        src = (src + 1) % pr->frames;
+        dst = (dst + 1) % runtime->buffer_size;
+    }
+
+    *pcm_pos += n;
+    return runtime->period_size && *pcm_pos / runtime->period_size != (*pcm_pos - n) / runtime->period_size;
+}
+
 static void zg01_iso_callback(struct urb *urb)
 {
     struct zg01_dev *dev = urb->context;
@@ -815,6 +1140,7 @@ static void zg01_iso_callback(struct urb *urb)
     bool is_game_channel = false;
     bool is_voice_out_channel = false;
     bool found_urb = false;
+    unsigned int preroll_fed = 0;
 
     /* Early exit for shutdown or critical errors */
     if (urb->status == -ESHUTDOWN || urb->status == -ENOENT || urb->status == -ECONNRESET) {
@@ -855,6 +1181,13 @@ static void zg01_iso_callback(struct urb *urb)
             break;
         }
     }
+
+    /* Fed under the same lock as the substream lookup, so a starting capture loses no frames */
+    if (found_urb && dev->preroll_armed && !is_game_channel && !is_voice_out_channel &&
+        urb->status == 0)
+        preroll_fed = zg01_preroll_feed(&dev->shared->preroll, urb);
+    if (found_urb)
+        zg01_link_advance(dev, urb, &dev->link_frame, &dev->link_ms);
     
     spin_unlock_irqrestore(&dev->lock, flags);
     
@@ -864,9 +1197,15 @@ static void zg01_iso_callback(struct urb *urb)
         return;
     }
 
+    /* The completed playback URB is what went out: feed the echo reference and stream mix */
+    if (is_game_channel || is_voice_out_channel)
+        zg01_playback_tap(dev, urb);
+
     /* Validate substream and runtime */
     if (!substream) {
         pr_debug("zg01_pcm: No substream in callback (stream stopped)\n");
+        if (dev->preroll_armed)
+            goto resubmit;
         return;
     }
 
@@ -905,11 +1244,52 @@ static void zg01_iso_callback(struct urb *urb)
     /* Process audio data based on stream direction */
     if (urb->status == 0) {
         bool period_elapsed = false;
-        unsigned int bytes_per_frame = runtime->frame_bits / 8; /* Should be 8 for S32_LE stereo */
+        u32 meter_peak[2] = { 0, 0 };
+        u64 meter_sumsq[2] = { 0, 0 };
+        unsigned int metered = 0;
+        unsigned int crossings = 0;     /* Zero crossings of the left capture channel */
+        int32_t prev_l = 0;
+        unsigned int bytes_per_frame = runtime->frame_bits / 8; /* 4, 6 or 8 for S16/S24_3/S32-wide stereo */
         
     if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
         /* PLAYBACK: Copy audio data FROM PCM buffer TO USB device WITH PADDING */
         unsigned int total_frames_processed = 0; /* Track frames processed in this URB */
+        unsigned int urb_frames = urb->number_of_packets * 6;
+        u32 gain_start[2], gain_end[2];
+        s32 gain_step[2];
+        bool apply_gain;
+        int ch;
+        struct zg01_sidetone *st;
+        u32 st_gain;
+        unsigned int st_pos, st_avail = 0;
+
+        /* Volume ramps from where the last URB ended to the current target */
+        spin_lock_irqsave(&dev->lock, flags);
+        for (ch = 0; ch < 2; ch++) {
+            gain_start[ch] = dev->control.gain_cur[ch];
+            gain_end[ch] = dev->control.gain_target[ch];
+            dev->control.gain_cur[ch] = gain_end[ch];
+            gain_step[ch] = ((s32)gain_end[ch] - (s32)gain_start[ch]) / (s32)urb_frames;
+        }
+        spin_unlock_irqrestore(&dev->lock, flags);
+        /* Unity gain skips the multiply */
+        apply_gain = !(gain_start[0] == ZG01_GAIN_UNITY && gain_end[0] == ZG01_GAIN_UNITY &&
+                       gain_start[1] == ZG01_GAIN_UNITY && gain_end[1] == ZG01_GAIN_UNITY);
+
+        /* Sidetone: take what Voice In has produced since the last URB */
+        st = &dev->shared->sidetone;
+        st_gain = READ_ONCE(dev->control.sidetone_gain);
+        st_pos = dev->control.sidetone_pos;
+        if (st_gain && READ_ONCE(st->rate) == runtime->rate) {
+            unsigned int head = smp_load_acquire(&st->head);
+
+            st_avail = head - st_pos;
+            if (st_avail > ZG01_SIDETONE_MAX_LAG) {
+                /* First use or fell behind: keep one URB of headroom */
+                st_pos = head - min(urb_frames, ZG01_SIDETONE_MAX_LAG);
+                st_avail = head - st_pos;
+            }
+        }
 
         /* For playback, packet sizes are already set during URB initialization */
         /* Process each packet and copy audio data */
@@ -938,28 +1318,46 @@ static void zg01_iso_callback(struct urb *urb)
                 unsigned int buffer_size_frames = runtime->buffer_size;
                 unsigned int frames_copied;
 
+                if (raw_mode) {
+                    /* Ring frames are wire frames: one span copy per packet */
+                    unsigned int frame_pos = (hw_pos_frames + total_frames_processed) % buffer_size_frames;
+                    bool active = is_game_channel ? dev->game_channel_active :
+                                  is_voice_out_channel ? dev->voice_out_channel_active :
+                                  dev->voice_channel_active;
+
+                    if (active)
+                        zg01_ring_read(pcm_buf, buffer_size_frames * bytes_per_frame,
+                                       frame_pos * bytes_per_frame, pkt_buf,
+                                       frames_per_packet * bytes_per_frame);
+                    else
+                        memset(pkt_buf, 0, pkt_len);
+                    total_frames_processed += frames_per_packet;
+                    spin_unlock_irqrestore(&dev->lock, flags);
+                    continue;
+                }
+
                 for (frames_copied = 0; frames_copied < frames_per_packet; frames_copied++) {
                     /* Calculate position in buffer (wrapping at buffer boundary) */
                     unsigned int frame_pos = (hw_pos_frames + total_frames_processed + frames_copied) % buffer_size_frames;
                     unsigned int pcm_frame_offset = frame_pos * bytes_per_frame;
-                    unsigned int buffer_size_bytes = buffer_size_frames * bytes_per_frame;
                     
                     int32_t sample_l, sample_r;
                     
-                    if (pcm_frame_offset + 8 <= buffer_size_bytes) {
-                        memcpy(&sample_l, pcm_buf + pcm_frame_offset, 4);
-                        memcpy(&sample_r, pcm_buf + pcm_frame_offset + 4, 4);
-                    } else {
-                        /* Wrapped read */
-                        unsigned int first_part = buffer_size_bytes - pcm_frame_offset;
-                        unsigned char tmp_buf[8];
-                        memcpy(tmp_buf, pcm_buf + pcm_frame_offset, first_part);
-                        memcpy(tmp_buf + first_part, pcm_buf, 8 - first_part);
-                        memcpy(&sample_l, tmp_buf, 4);
-                        memcpy(&sample_r, tmp_buf + 4, 4);
-                    }
+                    /* Frames never straddle the ring end; widen to the wire's 32-bit slot */
+                    sample_l = zg01_sample_read(pcm_buf + pcm_frame_offset, runtime->format);
+                    sample_r = zg01_sample_read(pcm_buf + pcm_frame_offset + bytes_per_frame / 2,
+                                                runtime->format);
                     
                     /* No shift needed - device expects samples in upper bits like ALSA S32_LE */
+
+                    if (apply_gain) {
+                        unsigned int n = total_frames_processed + frames_copied + 1;
+
+                        sample_l = zg01_apply_gain(sample_l, zg01_ramp_gain(gain_start[0], gain_end[0],
+                                                                            gain_step[0], n, urb_frames));
+                        sample_r = zg01_apply_gain(sample_r, zg01_ramp_gain(gain_start[1], gain_end[1],
+                                                                            gain_step[1], n, urb_frames));
+                    }
                     
                     /* Check if the channel is active */
                     bool is_active;
@@ -971,6 +1369,34 @@ static void zg01_iso_callback(struct urb *urb)
                         is_active = dev->voice_channel_active;
                     }
 
+                    if (st_avail) {
+                        const s32 *mic = st->buf[st_pos++ & (ZG01_SIDETONE_FRAMES - 1)];
+
+                        sample_l = zg01_mix_sat(sample_l, zg01_apply_gain(mic[0], st_gain));
+                        sample_r = zg01_mix_sat(sample_r, zg01_apply_gain(mic[1], st_gain));
+                        st_avail--;
+                    }
+
+                    if (is_active) {
+                        zg01_meter_sample(sample_l, &meter_peak[0], &meter_sumsq[0]);
+                        zg01_meter_sample(sample_r, &meter_peak[1], &meter_sumsq[1]);
+                    }
+                    metered++;
+
+                    if (!dev->control.route_default) {
+                        /* Routed frame: each slot carries its compiled source */
+                        int slot;
+
+                        for (slot = 0; slot < ZG01_FRAME_SLOTS; slot++) {
+                            int src = is_active ? dev->control.route_src[slot] : -1;
+                            int32_t sample = src < 0 ? 0 : (src ? sample_r : sample_l);
+
+                            memcpy(pkt_buf + pkt_offset, &sample, 4);
+                            pkt_offset += 4;
+                        }
+                        continue;
+                    }
+
                     /* 40-byte frame format: 8 zeros + L + R + 24 zeros */
                     memset(pkt_buf + pkt_offset, 0, 8);
                     pkt_offset += 8;
@@ -1007,6 +1433,8 @@ static void zg01_iso_callback(struct urb *urb)
             }
         }
             
+            dev->control.sidetone_pos = st_pos;
+
             /* Update global position once per URB for all processed frames */
             if (total_frames_processed > 0) {
                 spin_lock_irqsave(&dev->lock, flags);
@@ -1017,26 +1445,41 @@ static void zg01_iso_callback(struct urb *urb)
             }
         } else {
             /* CAPTURE: Copy audio data FROM USB device TO PCM buffer */
-            for (i = 0; i < urb->number_of_packets; i++) {
-                unsigned char *pkt_buf;
-                unsigned int pkt_len;
+            struct zg01_sidetone *st = &dev->shared->sidetone;
+            struct zg01_mix *mix = &dev->shared->mix;
+            bool mixing = !raw_mode && runtime->rate == ZG01_PKT_RATE && READ_ONCE(mix->running);
+            unsigned int mix_base = zg01_mix_urb_pos(dev, urb);
+            s32 pairs[ZG01_CAPTURE_MAX_PKT_FRAMES][2];
 
-                pkt_len = urb->iso_frame_desc[i].actual_length;
-                if (pkt_len != 108) /* Voice channel expects 108 bytes per packet */
-                    continue;
+            WRITE_ONCE(st->rate, runtime->rate);
 
-                pkt_buf = urb->transfer_buffer + urb->iso_frame_desc[i].offset;
-                
-                /* Voice channel packet format (108 bytes):
+            if (dev->preroll_armed) {
+                spin_lock_irqsave(&dev->lock, flags);
+                if (dev->shared->preroll.pending &&
+                    zg01_preroll_load(&dev->shared->preroll, runtime, pcm_pos, preroll_fed))
+                    period_elapsed = true;
+                spin_unlock_irqrestore(&dev->lock, flags);
+            }
+
+            for (i = 0; i < urb->number_of_packets; i++) {
+                unsigned char *pkt_buf;
+                unsigned int frames_per_packet;
+
+                frames_per_packet = zg01_capture_pkt_frames(urb->iso_frame_desc[i].actual_length);
+                if (!frames_per_packet)
+                    continue;
+
+                pkt_buf = urb->transfer_buffer + urb->iso_frame_desc[i].offset;
+                
+                /* Voice channel packet format (108 bytes at 48 kHz):
                  * - Bytes 0-7: Header (counter + size marker)
-                 * - Bytes 8-103: 6 frames × 16 bytes each
+                 * - Then frames_per_packet frames × 16 bytes each (6 at 48 kHz)
                  *   Each frame: 4 bytes L + 4 bytes R + 8 bytes padding
-                 * - Bytes 104-107: Trailer (counter repeat)
+                 * - Last 4 bytes: Trailer (counter repeat)
                  */
                 {
                     const unsigned int header_size = 8;
                     const unsigned int usb_frame_size = 16;
-                    const unsigned int frames_per_packet = 6;
                     unsigned int buffer_bytes = runtime->buffer_size * bytes_per_frame;
 
                     spin_lock_irqsave(&dev->lock, flags);
@@ -1045,7 +1488,14 @@ static void zg01_iso_callback(struct urb *urb)
                     unsigned int write_byte_pos = write_frame * bytes_per_frame;
                     unsigned int frames_written = 0;
 
-                    for (int f = 0; f < frames_per_packet; f++) {
+                    if (raw_mode) {
+                        /* Ring frames are wire frames: one span copy per packet */
+                        zg01_ring_write(pcm_buf, buffer_bytes, write_byte_pos, pkt_buf + header_size,
+                                        frames_per_packet * usb_frame_size);
+                        frames_written = frames_per_packet;
+                    }
+
+                    for (int f = 0; !raw_mode && f < frames_per_packet; f++) {
                         unsigned char *usb_frame = pkt_buf + header_size + (f * usb_frame_size);
                         int32_t sample_l, sample_r;
                         
@@ -1053,33 +1503,35 @@ static void zg01_iso_callback(struct urb *urb)
                         memcpy(&sample_l, usb_frame, 4);      /* Left at offset 0 */
                         memcpy(&sample_r, usb_frame + 4, 4);  /* Right at offset 4 */
 
-                        /* Write to DMA buffer */
-                        if (write_byte_pos + bytes_per_frame <= buffer_bytes) {
-                            memcpy(pcm_buf + write_byte_pos, &sample_l, 4);
-                            memcpy(pcm_buf + write_byte_pos + 4, &sample_r, 4);
-                        } else {
-                            /* Handle wraparound */
-                            unsigned int first_part = buffer_bytes - write_byte_pos;
-                            if (first_part >= 4) {
-                                memcpy(pcm_buf + write_byte_pos, &sample_l, 4);
-                                if (first_part >= 8) {
-                                    memcpy(pcm_buf + write_byte_pos + 4, &sample_r, 4);
-                                } else {
-                                    memcpy(pcm_buf + write_byte_pos + 4, &sample_r, first_part - 4);
-                                    memcpy(pcm_buf, ((unsigned char*)&sample_r) + (first_part - 4), 8 - first_part);
-                                }
-                            } else {
-                                memcpy(pcm_buf + write_byte_pos, &sample_l, first_part);
-                                memcpy(pcm_buf, ((unsigned char*)&sample_l) + first_part, 4 - first_part);
-                                memcpy(pcm_buf + (4 - first_part), &sample_r, 4);
-                            }
-                        }
+                        zg01_meter_sample(sample_l, &meter_peak[0], &meter_sumsq[0]);
+                        zg01_meter_sample(sample_r, &meter_peak[1], &meter_sumsq[1]);
+                        metered++;
+                        crossings += (sample_l ^ prev_l) < 0;
+                        prev_l = sample_l;
+
+                        pairs[f][0] = sample_l;
+                        pairs[f][1] = sample_r;
+
+                        /* Feed the sidetone ring (single producer) */
+                        st->buf[(st->head + f) & (ZG01_SIDETONE_FRAMES - 1)][0] = sample_l;
+                        st->buf[(st->head + f) & (ZG01_SIDETONE_FRAMES - 1)][1] = sample_r;
+
+                        /* Write to DMA buffer, narrowed to the PCM format (frames never straddle the ring end) */
+                        zg01_sample_write(pcm_buf + write_byte_pos, sample_l, runtime->format);
+                        zg01_sample_write(pcm_buf + write_byte_pos + bytes_per_frame / 2, sample_r,
+                                          runtime->format);
 
                         frames_written++;
                         write_frame = (write_frame + 1) % runtime->buffer_size;
                         write_byte_pos = write_frame * bytes_per_frame;
                     }
 
+                    if (!raw_mode)
+                        smp_store_release(&st->head, st->head + frames_written);
+                    /* The mix timeline carries six frames per packet */
+                    if (mixing && frames_per_packet == 6)
+                        zg01_mix_add(mix, CHANNEL_TYPE_VOICE_IN, mix_base + i * 6, pairs, 6);
+
                     *pcm_pos += frames_written;
                     if (period_size > 0 && ((*pcm_pos % period_size) == 0))
                         period_elapsed = true;
@@ -1087,10 +1539,19 @@ static void zg01_iso_callback(struct urb *urb)
                     spin_unlock_irqrestore(&dev->lock, flags);
                 }
             }
+
+            /* Voice In is a stream mix source and also keeps its delivery going */
+            zg01_mix_advance(mix, mix_base + urb->number_of_packets * 6);
         }
         
-        /* Call period_elapsed outside of spinlock */
-        if (period_elapsed) {
+        /* Publish level meters (not available in raw mode) */
+        if (metered)
+            zg01_meter_publish(dev, meter_peak, meter_sumsq, metered);
+        if (metered && substream->stream == SNDRV_PCM_STREAM_CAPTURE)
+            zg01_vad_publish(dev, meter_sumsq, crossings, metered, runtime->rate);
+
+        /* Call period_elapsed outside of spinlock; timer-driven clients poll the pointer instead */
+        if (period_elapsed && !runtime->no_period_wakeup) {
             snd_pcm_period_elapsed(substream);
         }
     }
@@ -1116,231 +1577,284 @@ resubmit:
 
 void zg01_pcm_start_work_fn(struct work_struct *work);
 
-/* Helper function to start streaming with multiple URBs */
-static int zg01_start_streaming(struct zg01_dev *dev, struct snd_pcm_substream *substream)
-{
-    int ret = 0;
-    int iso_pkts, iso_pkt_size;
+/* One channel's URB set and wire geometry */
+struct zg01_urb_set {
+    struct urb **urbs;
+    unsigned char **buffers;
+    dma_addr_t *dmas;
+    int *active;
+    bool *cleanup;
     unsigned int endpoint;
-    struct urb **iso_urbs;
-    unsigned char **iso_buffers;
-    dma_addr_t *iso_dmas;
-    int *active_urbs;
-    int urb_idx, i, j;
-    bool is_game_channel = (dev->channel_type == CHANNEL_TYPE_GAME);
-    bool is_voice_in_channel = (dev->channel_type == CHANNEL_TYPE_VOICE_IN);
+    int pkts, pkt_size, nr_urbs;
+    const char *name;
+};
+
+/* Look up the URB set of @dev's channel and size it from the discovered endpoint */
+static int zg01_get_urb_set(struct zg01_dev *dev, struct zg01_urb_set *set)
+{
+    set->nr_urbs = MAX_URBS_PER_CHANNEL;
 
     /* Select parameters based on channel type */
-    if (is_game_channel) {
-        /* Double-check cleanup is complete */
-        if (dev->cleanup_in_progress_game) {
-            pr_warn("zg01_pcm: Game cleanup still in progress, aborting start\n");
-            return -EBUSY;
-        }
-        
-        iso_pkts = ISO_PKTS_GAME;
-        iso_pkt_size = ISO_PKT_SIZE_GAME;
-        endpoint = ZG01_EP_GAME_OUT;
-        iso_urbs = dev->iso_urbs_game;
-        iso_buffers = dev->iso_buffers_game;
-        iso_dmas = dev->iso_dmas_game;
-        active_urbs = &dev->active_urbs_game;
-        dev->substream_game = substream;
-        pr_info("zg01_pcm: Starting Game channel (EP 0x%02x, %d URBs, %d bytes each)\n", 
-                endpoint, MAX_URBS_PER_CHANNEL, iso_pkt_size);
-    } else if (is_voice_in_channel) {
-        /* Double-check cleanup is complete */
-        if (dev->cleanup_in_progress_voice) {
-            pr_warn("zg01_pcm: Voice In cleanup still in progress, aborting start\n");
-            return -EBUSY;
-        }
-        
-        iso_pkts = ISO_PKTS_VOICE;
-        iso_pkt_size = ISO_PKT_SIZE_VOICE;
-        endpoint = ZG01_EP_VOICE_IN;
-        iso_urbs = dev->iso_urbs_voice;
-        iso_buffers = dev->iso_buffers_voice;
-        iso_dmas = dev->iso_dmas_voice;
-        active_urbs = &dev->active_urbs_voice;
-        dev->substream_voice = substream;
-        
-        /* Voice In channel only supports capture */
-        if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-            pr_warn("zg01_pcm: Voice In channel only supports capture (IN endpoint)\n");
-            return -ENODEV;
-        }
-        pr_info("zg01_pcm: Starting Voice In channel (EP 0x%02x, %d URBs, %d bytes each)\n", 
-                endpoint, MAX_URBS_PER_CHANNEL, iso_pkt_size);
+    if (dev->channel_type == CHANNEL_TYPE_GAME) {
+        set->pkts = ISO_PKTS_GAME;
+        set->pkt_size = ISO_PKT_SIZE_GAME;
+        set->nr_urbs = clamp_t(int, nr_playback_urbs, 2, MAX_URBS_PER_CHANNEL);
+        set->endpoint = ZG01_EP_GAME_OUT;
+        set->urbs = dev->iso_urbs_game;
+        set->buffers = dev->iso_buffers_game;
+        set->dmas = dev->iso_dmas_game;
+        set->active = &dev->active_urbs_game;
+        set->cleanup = &dev->cleanup_in_progress_game;
+        set->name = "Game";
+    } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
+        set->pkts = ISO_PKTS_VOICE;
+        set->pkt_size = ISO_PKT_SIZE_VOICE;
+        set->endpoint = ZG01_EP_VOICE_IN;
+        set->urbs = dev->iso_urbs_voice;
+        set->buffers = dev->iso_buffers_voice;
+        set->dmas = dev->iso_dmas_voice;
+        set->active = &dev->active_urbs_voice;
+        set->cleanup = &dev->cleanup_in_progress_voice;
+        set->name = "Voice In";
     } else {
         /* Voice Out channel - uses same parameters as game */
-        /* Double-check cleanup is complete */
-        if (dev->cleanup_in_progress_voice_out) {
-            pr_warn("zg01_pcm: Voice Out cleanup still in progress, aborting start\n");
-            return -EBUSY;
+        set->pkts = ISO_PKTS_GAME;
+        set->pkt_size = 240; /* Voice Out uses 240-byte packets */
+        set->nr_urbs = clamp_t(int, nr_playback_urbs, 2, MAX_URBS_PER_CHANNEL);
+        set->endpoint = ZG01_EP_GAME_OUT; /* Same endpoint as game */
+        set->urbs = dev->iso_urbs_voice_out;
+        set->buffers = dev->iso_buffers_voice_out;
+        set->dmas = dev->iso_dmas_voice_out;
+        set->active = &dev->active_urbs_voice_out;
+        set->cleanup = &dev->cleanup_in_progress_voice_out;
+        set->name = "Voice Out";
+    }
+
+    /* Endpoint and packet size as the descriptors report them; the constants are the fallback */
+    if (dev->stream.endpoint) {
+        if (dev->stream.in != !!(set->endpoint & USB_DIR_IN)) {
+            pr_err("zg01_pcm: Discovered EP 0x%02x has the wrong direction\n", dev->stream.endpoint);
+            return -ENODEV;
+        }
+        set->endpoint = dev->stream.endpoint;
+        if (dev->stream.in) {
+            /* Capture buffers must hold the largest packet the device may send */
+            set->pkt_size = dev->stream.max_packet;
+        } else if (dev->stream.max_packet < set->pkt_size) {
+            pr_err("zg01_pcm: EP 0x%02x takes %u bytes per packet, %d needed\n",
+                   set->endpoint, dev->stream.max_packet, set->pkt_size);
+            return -EINVAL;
         }
-        
-        iso_pkts = ISO_PKTS_GAME;
-        iso_pkt_size = 240; /* Voice Out uses 240-byte packets */
-        endpoint = ZG01_EP_GAME_OUT; /* Same endpoint as game */
-        iso_urbs = dev->iso_urbs_voice_out;
-        iso_buffers = dev->iso_buffers_voice_out;
-        iso_dmas = dev->iso_dmas_voice_out;
-        active_urbs = &dev->active_urbs_voice_out;
-        dev->substream_voice_out = substream; /* CRITICAL: Voice Out needs its own substream */
-        pr_info("zg01_pcm: Starting Voice Out channel (EP 0x%02x, %d URBs, %d bytes each)\n", 
-                endpoint, MAX_URBS_PER_CHANNEL, iso_pkt_size);
     }
+    return 0;
+}
 
-    /* Check if streaming is already active */
-    if (*active_urbs > 0) {
-        pr_info("zg01_pcm: Streaming already active (%d URBs), skipping start\n", *active_urbs);
-        return 0;  /* Return success since streaming is already running */
+static void zg01_wait_cleanup(struct zg01_dev *dev);
+
+/*
+ * Allocate and fill the URBs of @dev's channel, from prepare and the
+ * pre-roll start (process context). Trigger only submits them, so nothing
+ * is allocated under the PCM stream locks. URBs already allocated and not
+ * yet started are kept; a stopped channel's URBs go with its deferred
+ * cleanup, which is waited for here.
+ */
+static int zg01_alloc_streaming(struct zg01_dev *dev)
+{
+    struct zg01_urb_set set;
+    int urb_idx, i;
+    int ret;
+
+    ret = zg01_get_urb_set(dev, &set);
+    if (ret)
+        return ret;
+
+    /* Already streaming (pre-roll) */
+    if (*set.active > 0)
+        return 0;
+
+    zg01_wait_cleanup(dev);
+    if (READ_ONCE(*set.cleanup)) {
+        pr_warn("zg01_pcm: %s cleanup still in progress, not preparing URBs\n", set.name);
+        return -EBUSY;
     }
 
-    *active_urbs = 0;
+    /* Prepared again without a start */
+    if (set.urbs[0])
+        return 0;
 
     /* Allocate and prepare multiple URBs for smooth streaming */
-    for (urb_idx = 0; urb_idx < MAX_URBS_PER_CHANNEL; urb_idx++) {
+    for (urb_idx = 0; urb_idx < set.nr_urbs; urb_idx++) {
+        struct urb *urb;
+
         /* Allocate URB */
-        iso_urbs[urb_idx] = usb_alloc_urb(iso_pkts, GFP_KERNEL);
-        if (!iso_urbs[urb_idx]) {
+        urb = usb_alloc_urb(set.pkts, GFP_KERNEL);
+        if (!urb) {
             ret = -ENOMEM;
             goto cleanup_urbs;
         }
+        set.urbs[urb_idx] = urb;
 
         /* Allocate coherent buffer - try GFP_KERNEL first for xHCI compatibility */
-        iso_buffers[urb_idx] = kmalloc(iso_pkts * iso_pkt_size, GFP_KERNEL | GFP_DMA);
-        if (!iso_buffers[urb_idx]) {
-            usb_free_urb(iso_urbs[urb_idx]);
-            iso_urbs[urb_idx] = NULL;
+        set.buffers[urb_idx] = kmalloc(set.pkts * set.pkt_size, GFP_KERNEL | GFP_DMA);
+        if (!set.buffers[urb_idx]) {
             ret = -ENOMEM;
             goto cleanup_urbs;
         }
         /* For kmalloc'd memory, we don't have a separate DMA address */
-        iso_dmas[urb_idx] = 0;
+        set.dmas[urb_idx] = 0;
 
         /* Configure URB */
-        iso_urbs[urb_idx]->dev = dev->udev;
-        if (endpoint & USB_DIR_IN) {
-            iso_urbs[urb_idx]->pipe = usb_rcvisocpipe(dev->udev, endpoint & 0x0F);
+        urb->dev = dev->udev;
+        if (set.endpoint & USB_DIR_IN) {
+            urb->pipe = usb_rcvisocpipe(dev->udev, set.endpoint & 0x0F);
         } else {
-            iso_urbs[urb_idx]->pipe = usb_sndisocpipe(dev->udev, endpoint & 0x0F);
-        }
-        iso_urbs[urb_idx]->transfer_buffer = iso_buffers[urb_idx];
-        iso_urbs[urb_idx]->transfer_buffer_length = iso_pkts * iso_pkt_size;
-        iso_urbs[urb_idx]->complete = zg01_iso_callback;
-        iso_urbs[urb_idx]->context = dev;
-        iso_urbs[urb_idx]->interval = 1;  /* Back to 1ms interval with 1 packet per URB */
-        iso_urbs[urb_idx]->start_frame = -1;
-        iso_urbs[urb_idx]->number_of_packets = iso_pkts;
-        iso_urbs[urb_idx]->transfer_flags = URB_ISO_ASAP;
+            urb->pipe = usb_sndisocpipe(dev->udev, set.endpoint & 0x0F);
+        }
+        urb->transfer_buffer = set.buffers[urb_idx];
+        urb->transfer_buffer_length = set.pkts * set.pkt_size;
+        urb->complete = zg01_iso_callback;
+        urb->context = dev;
+        /* One packet per (micro)frame; high speed encodes bInterval as 2^(n-1) */
+        urb->interval = 1;
+        if (dev->stream.endpoint && dev->udev->speed >= USB_SPEED_HIGH)
+            urb->interval = 1 << (clamp_t(int, dev->stream.interval, 1, 16) - 1);
+        urb->start_frame = -1;
+        urb->number_of_packets = set.pkts;
+        urb->transfer_flags = URB_ISO_ASAP;
 
         /* Setup isochronous frame descriptors */
-        for (i = 0; i < iso_pkts; i++) {
-            iso_urbs[urb_idx]->iso_frame_desc[i].offset = i * iso_pkt_size;
-            iso_urbs[urb_idx]->iso_frame_desc[i].length = iso_pkt_size;
+        for (i = 0; i < set.pkts; i++) {
+            urb->iso_frame_desc[i].offset = i * set.pkt_size;
+            urb->iso_frame_desc[i].length = set.pkt_size;
         }
 
         /* For playback, pre-fill with silence */
-        if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
-            memset(iso_buffers[urb_idx], 0, iso_pkts * iso_pkt_size);
+        if (!(set.endpoint & USB_DIR_IN)) {
+            memset(set.buffers[urb_idx], 0, set.pkts * set.pkt_size);
         }
     }
 
+    pr_info("zg01_pcm: Prepared %d %s URBs (EP 0x%02x, %d bytes each)\n",
+            set.nr_urbs, set.name, set.endpoint, set.pkt_size);
+    return 0;
+
+cleanup_urbs:
+    /* Clean up only the URBs we actually allocated (up to urb_idx) */
+    for (i = 0; i <= urb_idx && i < MAX_URBS_PER_CHANNEL; i++) {
+        kfree(set.buffers[i]);
+        set.buffers[i] = NULL;
+        usb_free_urb(set.urbs[i]);
+        set.urbs[i] = NULL;
+    }
+    return ret;
+}
+
+static void zg01_release_urbs(struct zg01_dev *dev, struct zg01_urb_set *set);
+
+/* Helper function to start streaming with the URBs prepared by zg01_alloc_streaming().
+ * start_frame >= 0 schedules the first URB on that frame (linked start),
+ * -1 lets the host controller pick (URB_ISO_ASAP). Runs in atomic trigger context. */
+static int zg01_start_streaming(struct zg01_dev *dev, struct snd_pcm_substream *substream,
+                                int start_frame)
+{
+    struct zg01_urb_set set;
+    struct urb *urb;
+    int ret;
+    int urb_idx;
+
+    ret = zg01_get_urb_set(dev, &set);
+    if (ret)
+        return ret;
+
+    /* Voice In channel only supports capture (no substream: pre-roll) */
+    if (dev->channel_type == CHANNEL_TYPE_VOICE_IN && substream &&
+        substream->stream == SNDRV_PCM_STREAM_PLAYBACK) {
+        pr_warn("zg01_pcm: Voice In channel only supports capture (IN endpoint)\n");
+        return -ENODEV;
+    }
+
+    if (dev->channel_type == CHANNEL_TYPE_GAME) {
+        dev->substream_game = substream;
+    } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
+        dev->substream_voice = substream;
+    } else {
+        dev->substream_voice_out = substream; /* CRITICAL: Voice Out needs its own substream */
+    }
+
+    /* Check if streaming is already active */
+    if (*set.active > 0) {
+        pr_info("zg01_pcm: Streaming already active (%d URBs), skipping start\n", *set.active);
+        return 0;  /* Return success since streaming is already running */
+    }
+
+    /* Double-check cleanup is complete */
+    if (*set.cleanup || !set.urbs[0]) {
+        pr_warn("zg01_pcm: %s URBs not prepared, aborting start\n", set.name);
+        return -EBUSY;
+    }
+
+    pr_info("zg01_pcm: Starting %s channel (EP 0x%02x, %d bytes per packet)\n",
+            set.name, set.endpoint, set.pkt_size);
+
+    /* Linked start: pin the first URB, the rest queue behind it */
+    if (start_frame >= 0) {
+        set.urbs[0]->transfer_flags = 0;
+        set.urbs[0]->start_frame = start_frame;
+    }
+
     /* Submit all URBs */
-    for (urb_idx = 0; urb_idx < MAX_URBS_PER_CHANNEL; urb_idx++) {
-        ret = usb_submit_urb(iso_urbs[urb_idx], GFP_KERNEL);
+    for (urb_idx = 0; urb_idx < MAX_URBS_PER_CHANNEL && set.urbs[urb_idx]; urb_idx++) {
+        urb = set.urbs[urb_idx];
+        ret = usb_submit_urb(urb, GFP_ATOMIC);
+        if (ret && urb_idx == 0 && start_frame >= 0) {
+            /* Start frame already missed or out of the controller's window */
+            pr_warn("zg01_pcm: Linked start at frame %d rejected (%d), starting ASAP\n",
+                    start_frame, ret);
+            urb->transfer_flags = URB_ISO_ASAP;
+            urb->start_frame = -1;
+            ret = usb_submit_urb(urb, GFP_ATOMIC);
+        }
         if (ret) {
             pr_err("zg01_pcm: Failed to submit URB %d: %d (EAGAIN=%d, ENODEV=%d, ENOMEM=%d)\n",
                    urb_idx, ret, -EAGAIN, -ENODEV, -ENOMEM);
             pr_err("zg01_pcm: URB details - EP: 0x%02x, interval: %d, num_packets: %d\n",
-                   usb_pipeendpoint(iso_urbs[urb_idx]->pipe),
-                   iso_urbs[urb_idx]->interval,
-                   iso_urbs[urb_idx]->number_of_packets);
-            goto cleanup_submitted_urbs;
+                   usb_pipeendpoint(urb->pipe), urb->interval, urb->number_of_packets);
+            /* Submitted URBs can't be killed here; they go with the deferred cleanup */
+            zg01_release_urbs(dev, &set);
+            return ret;
         }
-         /* Log successful submission for debugging (limited info) */
-         pr_info("zg01_pcm: Submitted URB %d -> EP: 0x%02x, num_pkts: %d, pkt_size: %d\n",
-              urb_idx, usb_pipeendpoint(iso_urbs[urb_idx]->pipe), iso_urbs[urb_idx]->number_of_packets, iso_pkt_size);
-        (*active_urbs)++;
+        (*set.active)++;
     }
 
-    pr_info("zg01_pcm: Successfully started streaming with %d URBs\n", *active_urbs);
+    pr_info("zg01_pcm: Successfully started streaming with %d URBs (start frame %d)\n",
+            *set.active, set.urbs[0]->start_frame);
     return 0;
-
-cleanup_submitted_urbs:
-    /* Kill any already submitted URBs */
-    for (j = 0; j < urb_idx; j++) {
-        if (iso_urbs[j]) {
-            usb_kill_urb(iso_urbs[j]);
-        }
-    }
-
-cleanup_urbs:
-    /* Clean up only the URBs we actually allocated (up to urb_idx) */
-    for (j = 0; j <= urb_idx && j < MAX_URBS_PER_CHANNEL; j++) {
-        if (iso_buffers[j]) {
-            kfree(iso_buffers[j]);
-            iso_buffers[j] = NULL;
-        }
-        if (iso_urbs[j]) {
-            usb_free_urb(iso_urbs[j]);
-            iso_urbs[j] = NULL;
-        }
-    }
-    *active_urbs = 0;
-    return ret;
 }
 
-/* Helper function to stop streaming and clean up URBs */
-static void zg01_stop_streaming(struct zg01_dev *dev)
+/*
+ * Unlink a channel's URBs and hand them to a work item that kills and frees
+ * them; safe in atomic context. The channel can be prepared again once the
+ * cleanup flag clears.
+ */
+static void zg01_release_urbs(struct zg01_dev *dev, struct zg01_urb_set *set)
 {
-    struct urb **iso_urbs;
-    unsigned char **iso_buffers;
-    dma_addr_t *iso_dmas;
-    int *active_urbs;
-    bool *cleanup_in_progress;
-    int i;
-    bool is_game_channel = (dev->channel_type == CHANNEL_TYPE_GAME);
-    bool is_voice_in_channel = (dev->channel_type == CHANNEL_TYPE_VOICE_IN);
+    struct zg01_cleanup_work *cw;
     unsigned long flags;
-
-    if (is_game_channel) {
-        iso_urbs = dev->iso_urbs_game;
-        iso_buffers = dev->iso_buffers_game;
-        iso_dmas = dev->iso_dmas_game;
-        active_urbs = &dev->active_urbs_game;
-        cleanup_in_progress = &dev->cleanup_in_progress_game;
-        pr_info("zg01_pcm: Stopping Game channel\n");
-    } else if (is_voice_in_channel) {
-        iso_urbs = dev->iso_urbs_voice;
-        iso_buffers = dev->iso_buffers_voice;
-        iso_dmas = dev->iso_dmas_voice;
-        active_urbs = &dev->active_urbs_voice;
-        cleanup_in_progress = &dev->cleanup_in_progress_voice;
-        pr_info("zg01_pcm: Stopping Voice In channel\n");
-    } else {
-        iso_urbs = dev->iso_urbs_voice_out;
-        iso_buffers = dev->iso_buffers_voice_out;
-        iso_dmas = dev->iso_dmas_voice_out;
-        active_urbs = &dev->active_urbs_voice_out;
-        cleanup_in_progress = &dev->cleanup_in_progress_voice_out;
-        pr_info("zg01_pcm: Stopping Voice Out channel\n");
-    }
+    int i;
 
     spin_lock_irqsave(&dev->lock, flags);
-    *cleanup_in_progress = true;
+    *set->cleanup = true;
     spin_unlock_irqrestore(&dev->lock, flags);
 
     /* First unlink all URBs (non-blocking) */
     for (i = 0; i < MAX_URBS_PER_CHANNEL; i++) {
-        if (iso_urbs[i]) {
-            usb_unlink_urb(iso_urbs[i]);
+        if (set->urbs[i]) {
+            usb_unlink_urb(set->urbs[i]);
         }
     }
 
     /* Create cleanup work for deferred cleanup (can sleep) */
-    struct zg01_cleanup_work *cw = kzalloc(sizeof(*cw), GFP_ATOMIC);
+    cw = kzalloc(sizeof(*cw), GFP_ATOMIC);
     if (cw) {
         INIT_WORK(&cw->work, zg01_cleanup_multi_urb_work_fn);
         cw->dev = dev;
@@ -1353,10 +1867,141 @@ static void zg01_stop_streaming(struct zg01_dev *dev)
         }
     }
     
-    *active_urbs = 0;
+    *set->active = 0;
+}
+
+/* Helper function to stop streaming and clean up URBs */
+static void zg01_stop_streaming(struct zg01_dev *dev)
+{
+    struct zg01_urb_set set;
+    unsigned long flags;
+
+    /* Pre-roll keeps the Voice In URBs running; they go with the device */
+    if (dev->preroll_armed) {
+        spin_lock_irqsave(&dev->lock, flags);
+        dev->shared->preroll.pending = false;
+        spin_unlock_irqrestore(&dev->lock, flags);
+        return;
+    }
+
+    zg01_get_urb_set(dev, &set);
+    pr_info("zg01_pcm: Stopping %s channel\n", set.name);
+    zg01_release_urbs(dev, &set);
     pr_info("zg01_pcm: URBs unlinked, cleanup deferred\n");
 }
 
+/* Start one stream and mark its channel active */
+static int zg01_trigger_start(struct zg01_dev *dev, struct snd_pcm_substream *substream,
+                              int start_frame)
+{
+    unsigned long flags;
+    int ret;
+
+    ret = zg01_start_streaming(dev, substream, start_frame);
+    if (ret < 0) {
+        pr_err("zg01_pcm: Failed to start streaming in trigger: %d\n", ret);
+        return ret;
+    }
+
+    /* Link time starts over at the first URB completing for this run (URBs may already be running for the pre-roll) */
+    spin_lock_irqsave(&dev->lock, flags);
+    dev->link_frame = -1;
+    dev->link_ms = 0;
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    if (dev->channel_type == CHANNEL_TYPE_GAME) {
+        dev->game_channel_active = true;
+        pr_info("zg01_pcm: Trigger START - Game channel playing\n");
+    } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
+        dev->voice_channel_active = true;
+        if (dev->preroll_armed) {
+            spin_lock_irqsave(&dev->lock, flags);
+            dev->shared->preroll.pending = true;
+            spin_unlock_irqrestore(&dev->lock, flags);
+        }
+        pr_info("zg01_pcm: Trigger START - Voice In channel playing\n");
+    } else {
+        dev->voice_out_channel_active = true;
+        pr_info("zg01_pcm: Trigger START - Voice Out channel playing\n");
+    }
+    return 0;
+}
+
+/* Stop streaming completely to allow clean restart */
+static void zg01_trigger_stop(struct zg01_dev *dev)
+{
+    if (dev->channel_type == CHANNEL_TYPE_GAME) {
+        dev->game_channel_active = false;
+        pr_info("zg01_pcm: Trigger STOP - Game channel stopping\n");
+    } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
+        dev->voice_channel_active = false;
+        zg01_vad_publish(dev, NULL, 0, 0, 0);
+        pr_info("zg01_pcm: Trigger STOP - Voice In channel stopping\n");
+    } else {
+        dev->voice_out_channel_active = false;
+        pr_info("zg01_pcm: Trigger STOP - Voice Out channel stopping\n");
+    }
+    /* Stop URBs to ensure clean restart with new parameters */
+    zg01_stop_streaming(dev);
+}
+
+/*
+ * Common start frame for linked streams, in the units the host controller
+ * expects in urb->start_frame: microframes for a high-speed device.
+ */
+static int zg01_link_start_frame(struct zg01_dev *dev)
+{
+    int frame;
+
+    frame = usb_get_current_frame_number(dev->udev);
+    if (frame < 0)
+        return -1;
+    return (frame + ZG01_LINK_START_DELAY_FRAMES) << zg01_frame_shift(dev);
+}
+
+/*
+ * snd_pcm_link() group start: every ZG01 stream of this USB device in the
+ * group gets its first URB on the same bus frame, so playback and capture
+ * start with a fixed phase offset instead of wherever ISO_ASAP lands them.
+ * Streams handled here are marked done so ALSA does not trigger them again.
+ */
+static int zg01_trigger_start_linked(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    struct snd_pcm_substream *s, *started;
+    int start_frame = zg01_link_start_frame(dev);
+    int ret;
+
+    snd_pcm_group_for_each_entry(s, substream) {
+        struct zg01_dev *d = snd_pcm_substream_chip(s);
+
+        /* Only streams on this device share its frame counter */
+        if (s->ops->trigger != zg01_pcm_trigger || d->udev != dev->udev)
+            continue;
+
+        ret = zg01_trigger_start(d, s, start_frame);
+        if (ret < 0)
+            goto undo;
+        if (s != substream)
+            snd_pcm_trigger_done(s, substream);
+    }
+
+    pr_info("zg01_pcm: Linked streams started at frame %d\n", start_frame);
+    return 0;
+
+undo:
+    snd_pcm_group_for_each_entry(started, substream) {
+        struct zg01_dev *d = snd_pcm_substream_chip(started);
+
+        if (started == s)
+            break;
+        if (started->ops->trigger != zg01_pcm_trigger || d->udev != dev->udev)
+            continue;
+        zg01_trigger_stop(d);
+    }
+    return ret;
+}
+
 static int zg01_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
 {
     struct zg01_dev *dev = snd_pcm_substream_chip(substream);
@@ -1394,38 +2039,17 @@ static int zg01_pcm_trigger(struct snd_pcm_substream *substream, int cmd)
     switch (cmd) {
     case SNDRV_PCM_TRIGGER_START:
         /* Start streaming and mark channel as active */
-        ret = zg01_start_streaming(dev, substream);
-        if (ret < 0) {
-            pr_err("zg01_pcm: Failed to start streaming in trigger: %d\n", ret);
+        if (snd_pcm_stream_linked(substream))
+            ret = zg01_trigger_start_linked(substream);
+        else
+            ret = zg01_trigger_start(dev, substream, -1);
+        if (ret < 0)
             return ret;
-        }
-        
-        if (dev->channel_type == CHANNEL_TYPE_GAME) {
-            dev->game_channel_active = true;
-            pr_info("zg01_pcm: Trigger START - Game channel playing\n");
-        } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
-            dev->voice_channel_active = true;
-            pr_info("zg01_pcm: Trigger START - Voice In channel playing\n");
-        } else {
-            dev->voice_out_channel_active = true;
-            pr_info("zg01_pcm: Trigger START - Voice Out channel playing\n");
-        }
         break;
 
     case SNDRV_PCM_TRIGGER_STOP:
-        /* Stop streaming completely to allow clean restart */
-        if (dev->channel_type == CHANNEL_TYPE_GAME) {
-            dev->game_channel_active = false;
-            pr_info("zg01_pcm: Trigger STOP - Game channel stopping\n");
-        } else if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
-            dev->voice_channel_active = false;
-            pr_info("zg01_pcm: Trigger STOP - Voice In channel stopping\n");
-        } else {
-            dev->voice_out_channel_active = false;
-            pr_info("zg01_pcm: Trigger STOP - Voice Out channel stopping\n");
-        }
-        /* Stop URBs to ensure clean restart with new parameters */
-        zg01_stop_streaming(dev);
+    case SNDRV_PCM_TRIGGER_SUSPEND:
+        zg01_trigger_stop(dev);
         break;
 
     default:
@@ -1461,6 +2085,70 @@ static snd_pcm_uframes_t zg01_pcm_pointer(struct snd_pcm_substream *substream)
     return pos % runtime->buffer_size;
 }
 
+/*
+ * LINK audio timestamps from the bus frame counter: the time elapsed since
+ * the stream's first URB went on the wire, read back to back with the
+ * system timestamp. The counter ticks once per 1 ms frame, so the middle
+ * of the current frame is reported, within half a frame either way.
+ * @link_frame and @link_ms are the stream's link clock, under dev->lock.
+ */
+static int zg01_link_time_info(struct snd_pcm_substream *substream,
+                               const int *link_frame, const unsigned int *link_ms,
+                               struct timespec64 *system_ts, struct timespec64 *audio_ts,
+                               struct snd_pcm_audio_tstamp_config *audio_tstamp_config,
+                               struct snd_pcm_audio_tstamp_report *audio_tstamp_report)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    unsigned long flags;
+    unsigned int ms = 0;
+    int frame = -1;
+
+    if (audio_tstamp_config->type_requested == SNDRV_PCM_AUDIO_TSTAMP_TYPE_LINK ||
+        audio_tstamp_config->type_requested == SNDRV_PCM_AUDIO_TSTAMP_TYPE_LINK_SYNCHRONIZED) {
+        spin_lock_irqsave(&dev->lock, flags);
+        if (*link_frame >= 0) {
+            frame = usb_get_current_frame_number(dev->udev);
+            snd_pcm_gettime(substream->runtime, system_ts);
+            if (frame >= 0) {
+                unsigned int gap = (frame - *link_frame) & ZG01_LINK_FRAME_MASK;
+
+                /* The last completion is recent; anything else is a unit or wrap mismatch */
+                if (gap > ZG01_LINK_MAX_GAP_MS) {
+                    pr_warn_once("zg01_pcm: Bus frame %d is %u frames past the last URB, clamped\n",
+                                 frame, gap);
+                    gap = ZG01_LINK_MAX_GAP_MS;
+                }
+                ms = *link_ms + gap;
+            }
+        }
+        spin_unlock_irqrestore(&dev->lock, flags);
+    }
+
+    if (frame < 0) {
+        /* Not running yet, or not asked for: the core derives the audio time from hw_ptr */
+        snd_pcm_gettime(substream->runtime, system_ts);
+        audio_tstamp_report->actual_type = SNDRV_PCM_AUDIO_TSTAMP_TYPE_DEFAULT;
+        return 0;
+    }
+
+    *audio_ts = ns_to_timespec64((u64)ms * NSEC_PER_MSEC + NSEC_PER_MSEC / 2);
+    audio_tstamp_report->actual_type = audio_tstamp_config->type_requested;
+    audio_tstamp_report->accuracy_report = 1;
+    audio_tstamp_report->accuracy = NSEC_PER_MSEC / 2;
+    return 0;
+}
+
+static int zg01_pcm_get_time_info(struct snd_pcm_substream *substream,
+                                  struct timespec64 *system_ts, struct timespec64 *audio_ts,
+                                  struct snd_pcm_audio_tstamp_config *audio_tstamp_config,
+                                  struct snd_pcm_audio_tstamp_report *audio_tstamp_report)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+
+    return zg01_link_time_info(substream, &dev->link_frame, &dev->link_ms, system_ts, audio_ts,
+                               audio_tstamp_config, audio_tstamp_report);
+}
+
 static int zg01_pcm_ioctl(struct snd_pcm_substream *substream,
                           unsigned int cmd, void *arg)
 {
@@ -1478,8 +2166,254 @@ static struct snd_pcm_ops zg01_pcm_ops = {
     .prepare = zg01_pcm_prepare,
     .trigger = zg01_pcm_trigger,
     .pointer = zg01_pcm_pointer,
+    .get_time_info = zg01_pcm_get_time_info,
+};
+
+/* Tap captures (echo reference, stream mix): stereo S32_LE at 48 kHz, one URB per delivery */
+static int zg01_tap_hw_init(struct snd_pcm_runtime *runtime)
+{
+    runtime->hw.info = SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_INTERLEAVED |
+                       SNDRV_PCM_INFO_BLOCK_TRANSFER | SNDRV_PCM_INFO_MMAP_VALID |
+                       SNDRV_PCM_INFO_SYNC_START | SNDRV_PCM_INFO_NO_PERIOD_WAKEUP;
+    runtime->hw.formats = SNDRV_PCM_FMTBIT_S32_LE;
+    runtime->hw.rates = SNDRV_PCM_RATE_48000;
+    runtime->hw.rate_min = ZG01_PKT_RATE;
+    runtime->hw.rate_max = ZG01_PKT_RATE;
+    runtime->hw.channels_min = 2;
+    runtime->hw.channels_max = 2;
+    runtime->hw.buffer_bytes_max = PCM_BUFFER_BYTES_MAX_GAME;
+    runtime->hw.period_bytes_min = PCM_PERIOD_BYTES_MIN_GAME;
+    runtime->hw.period_bytes_max = PCM_PERIOD_BYTES_MAX_GAME;
+    runtime->hw.periods_min = 2;
+    runtime->hw.periods_max = 64;
+
+    /* Delivered one URB (192 frames) at a time */
+    return snd_pcm_hw_constraint_step(runtime, 0, SNDRV_PCM_HW_PARAM_PERIOD_BYTES, 1536);
+}
+
+/* Echo reference capture, fed by zg01_playback_tap() */
+static int zg01_echo_open(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    unsigned long flags;
+    int ret;
+
+    ret = zg01_tap_hw_init(substream->runtime);
+    if (ret < 0)
+        return ret;
+    substream->runtime->hw.info |= SNDRV_PCM_INFO_HAS_LINK_ATIME |
+                                   SNDRV_PCM_INFO_HAS_LINK_SYNCHRONIZED_ATIME;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    if (dev->echo_substream) {
+        spin_unlock_irqrestore(&dev->lock, flags);
+        return -EBUSY;
+    }
+    dev->echo_substream = substream;
+    dev->echo_running = false;
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static int zg01_echo_close(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    dev->echo_running = false;
+    dev->echo_substream = NULL;
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+static int zg01_echo_prepare(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    unsigned long flags;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    dev->echo_pos = 0;
+    dev->echo_link_frame = -1;
+    spin_unlock_irqrestore(&dev->lock, flags);
+    return 0;
+}
+
+/* The reference only flows while the playback stream keeps URBs in flight */
+static int zg01_echo_trigger(struct snd_pcm_substream *substream, int cmd)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+
+    switch (cmd) {
+    case SNDRV_PCM_TRIGGER_START:
+        spin_lock(&dev->lock);
+        dev->echo_running = true;
+        dev->echo_link_frame = -1;
+        spin_unlock(&dev->lock);
+        return 0;
+    case SNDRV_PCM_TRIGGER_STOP:
+    case SNDRV_PCM_TRIGGER_SUSPEND:
+        spin_lock(&dev->lock);
+        dev->echo_running = false;
+        spin_unlock(&dev->lock);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+static snd_pcm_uframes_t zg01_echo_pointer(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    unsigned int pos;
+
+    spin_lock(&dev->lock);
+    pos = dev->echo_pos;
+    spin_unlock(&dev->lock);
+
+    return pos % substream->runtime->buffer_size;
+}
+
+/*
+ * The echo reference runs on the playback URBs' bus frames, so its LINK
+ * timestamps and those of Voice In place both captures on one timeline:
+ * the offset between a reference frame and the capture frame it aligns
+ * with follows from the two (system time, audio time) pairs.
+ */
+static int zg01_echo_get_time_info(struct snd_pcm_substream *substream,
+                                   struct timespec64 *system_ts, struct timespec64 *audio_ts,
+                                   struct snd_pcm_audio_tstamp_config *audio_tstamp_config,
+                                   struct snd_pcm_audio_tstamp_report *audio_tstamp_report)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+
+    return zg01_link_time_info(substream, &dev->echo_link_frame, &dev->echo_link_ms, system_ts,
+                               audio_ts, audio_tstamp_config, audio_tstamp_report);
+}
+
+static struct snd_pcm_ops zg01_echo_ops = {
+    .open = zg01_echo_open,
+    .close = zg01_echo_close,
+    .prepare = zg01_echo_prepare,
+    .trigger = zg01_echo_trigger,
+    .pointer = zg01_echo_pointer,
+    .get_time_info = zg01_echo_get_time_info,
+};
+
+/* Stream mix capture, fed by zg01_mix_advance() */
+static int zg01_mix_open(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    struct zg01_mix *mix = &dev->shared->mix;
+    unsigned long flags;
+    int ret;
+
+    ret = zg01_tap_hw_init(substream->runtime);
+    if (ret < 0)
+        return ret;
+
+    spin_lock_irqsave(&mix->lock, flags);
+    if (mix->substream) {
+        spin_unlock_irqrestore(&mix->lock, flags);
+        return -EBUSY;
+    }
+    mix->substream = substream;
+    mix->running = false;
+    spin_unlock_irqrestore(&mix->lock, flags);
+    return 0;
+}
+
+static int zg01_mix_close(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    struct zg01_mix *mix = &dev->shared->mix;
+    unsigned long flags;
+
+    spin_lock_irqsave(&mix->lock, flags);
+    mix->running = false;
+    mix->substream = NULL;
+    spin_unlock_irqrestore(&mix->lock, flags);
+    return 0;
+}
+
+static int zg01_mix_prepare(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    struct zg01_mix *mix = &dev->shared->mix;
+    unsigned long flags;
+
+    spin_lock_irqsave(&mix->lock, flags);
+    mix->pos = 0;
+    spin_unlock_irqrestore(&mix->lock, flags);
+    return 0;
+}
+
+/* Sources only contribute while their own streams are running */
+static int zg01_mix_trigger(struct snd_pcm_substream *substream, int cmd)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    struct zg01_mix *mix = &dev->shared->mix;
+
+    switch (cmd) {
+    case SNDRV_PCM_TRIGGER_START:
+        spin_lock(&mix->lock);
+        memset(mix->buf, 0, sizeof(mix->buf));
+        mix->synced = false;
+        mix->running = true;
+        spin_unlock(&mix->lock);
+        return 0;
+    case SNDRV_PCM_TRIGGER_STOP:
+    case SNDRV_PCM_TRIGGER_SUSPEND:
+        spin_lock(&mix->lock);
+        mix->running = false;
+        spin_unlock(&mix->lock);
+        return 0;
+    default:
+        return -EINVAL;
+    }
+}
+
+static snd_pcm_uframes_t zg01_mix_pointer(struct snd_pcm_substream *substream)
+{
+    struct zg01_dev *dev = snd_pcm_substream_chip(substream);
+    struct zg01_mix *mix = &dev->shared->mix;
+    unsigned int pos;
+
+    spin_lock(&mix->lock);
+    pos = mix->pos;
+    spin_unlock(&mix->lock);
+
+    return pos % substream->runtime->buffer_size;
+}
+
+static struct snd_pcm_ops zg01_mix_ops = {
+    .open = zg01_mix_open,
+    .close = zg01_mix_close,
+    .prepare = zg01_mix_prepare,
+    .trigger = zg01_mix_trigger,
+    .pointer = zg01_mix_pointer,
 };
 
+/* Stream mix loopback PCM on the Voice In card */
+static int zg01_create_mix_pcm(struct zg01_dev *dev)
+{
+    struct snd_pcm *pcm;
+    int ret;
+
+    ret = snd_pcm_new(dev->card, "ZG01 Stream Mix", ZG01_MIX_PCM_DEVICE, 0, 1, &pcm);
+    if (ret < 0) {
+        pr_err("zg01_pcm: Failed to create Stream Mix PCM device: %d\n", ret);
+        return ret;
+    }
+    snd_pcm_set_ops(pcm, SNDRV_PCM_STREAM_CAPTURE, &zg01_mix_ops);
+    pcm->private_data = dev;
+    strscpy(pcm->name, "Yamaha ZG01 Stream Mix PCM", sizeof(pcm->name));
+    snd_pcm_set_managed_buffer_all(pcm, SNDRV_DMA_TYPE_CONTINUOUS, NULL,
+                                   PCM_BUFFER_BYTES_MAX_GAME, PCM_BUFFER_BYTES_MAX_GAME);
+
+    return snd_pcm_add_chmap_ctls(pcm, SNDRV_PCM_STREAM_CAPTURE, zg01_chmaps_stereo, 2, 0, NULL);
+}
+
 int zg01_create_pcm(struct zg01_dev *dev)
 {
     struct zg01_pcm *pcm;
@@ -1526,13 +2460,7 @@ int zg01_create_pcm(struct zg01_dev *dev)
         pr_info("zg01_pcm: Creating Voice Out channel (interface %d, type %d)\n", iface_num, dev->channel_type);
     }
 
-    if (!dev->udev) {
-        pr_warn("zg01_pcm: No usb_device available; skipping usb_set_interface\n");
-    } else {
-        ret = usb_set_interface(dev->udev, iface_num, 1);
-        if (ret < 0)
-            pr_err("zg01_pcm: Failed to set interface: %d\n", ret);
-    }
+    /* Alt settings are left to the shared context; streams claim them on open */
 
     pcm = &dev->pcm;
     pcm->zg01 = dev;
@@ -1541,12 +2469,14 @@ int zg01_create_pcm(struct zg01_dev *dev)
     if (dev->channel_type == CHANNEL_TYPE_GAME || dev->channel_type == CHANNEL_TYPE_VOICE_OUT) {
         /* Game channel and Voice Out - playback only */
         const char *pcm_name = (dev->channel_type == CHANNEL_TYPE_GAME) ? "ZG01 Game" : "ZG01 Voice Out";
-        ret = snd_pcm_new(dev->card, pcm_name, 0, 1, 0, &pcm->instance);
+        /* One playback substream plus the echo reference capture substream */
+        ret = snd_pcm_new(dev->card, pcm_name, dev->pcm_device, 1, 1, &pcm->instance);
         if (ret < 0) {
             pr_err("zg01_pcm: Failed to create playback PCM device (type %d): %d\n", dev->channel_type, ret);
             return ret;
         }
         snd_pcm_set_ops(pcm->instance, SNDRV_PCM_STREAM_PLAYBACK, &zg01_pcm_ops);
+        snd_pcm_set_ops(pcm->instance, SNDRV_PCM_STREAM_CAPTURE, &zg01_echo_ops);
         if (dev->channel_type == CHANNEL_TYPE_GAME) {
             pr_info("zg01_pcm: Created Game channel (playback only)\n");
         } else {
@@ -1555,7 +2485,7 @@ int zg01_create_pcm(struct zg01_dev *dev)
         }
     } else {
         /* Voice In channel - capture only */
-        ret = snd_pcm_new(dev->card, "ZG01 Voice In", 0, 0, 1, &pcm->instance);
+        ret = snd_pcm_new(dev->card, "ZG01 Voice In", dev->pcm_device, 0, 1, &pcm->instance);
         if (ret < 0) {
             pr_err("zg01_pcm: Failed to create Voice In PCM device: %d\n", ret);
             return ret;
@@ -1568,14 +2498,35 @@ int zg01_create_pcm(struct zg01_dev *dev)
     pcm->instance->private_free = NULL;
     strscpy(pcm->instance->name, channel_name, sizeof(pcm->instance->name));
 
+    buffer_size *= zg01_frame_scale(dev);
     snd_pcm_set_managed_buffer_all(pcm->instance,
                                   SNDRV_DMA_TYPE_CONTINUOUS, NULL,
                                   buffer_size, buffer_size);
 
+    if (dev->channel_type == CHANNEL_TYPE_VOICE_IN)
+        ret = snd_pcm_add_chmap_ctls(pcm->instance, SNDRV_PCM_STREAM_CAPTURE,
+                                     raw_mode ? zg01_chmaps_raw_in : zg01_chmaps_stereo,
+                                     2 * zg01_frame_scale(dev), 0, NULL);
+    else
+        ret = snd_pcm_add_chmap_ctls(pcm->instance, SNDRV_PCM_STREAM_PLAYBACK,
+                                     raw_mode ? zg01_chmaps_raw_out : zg01_chmaps_stereo,
+                                     2 * zg01_frame_scale(dev), 0, NULL);
+    if (ret < 0) {
+        pr_err("zg01_pcm: Failed to add channel map controls: %d\n", ret);
+        return ret;
+    }
+
+    if (dev->channel_type == CHANNEL_TYPE_VOICE_IN) {
+        ret = zg01_create_mix_pcm(dev);
+        if (ret < 0)
+            return ret;
+    }
+
     /* Initialize deferred start work and pending flags */
     INIT_DELAYED_WORK(&dev->start_work_game, zg01_pcm_start_work);
     INIT_DELAYED_WORK(&dev->start_work_voice, zg01_pcm_start_work);
     INIT_DELAYED_WORK(&dev->start_work_voice_out, zg01_pcm_start_work);
+    INIT_WORK(&dev->preroll_work, zg01_preroll_work);
     dev->start_pending_game = false;
     dev->start_pending_voice = false;
     dev->start_pending_voice_out = false;
@@ -1585,6 +2536,156 @@ int zg01_create_pcm(struct zg01_dev *dev)
 
 EXPORT_SYMBOL_GPL(zg01_create_pcm);
 
+/* Arm the interface and start the pre-roll URBs (no substream attached) */
+static int zg01_preroll_run(struct zg01_dev *dev)
+{
+    int ret;
+
+    ret = zg01_shared_arm(dev->shared, zg01_channel_iface(dev), &dev->preroll_armed);
+    if (ret < 0)
+        return ret;
+
+    mutex_lock(&dev->pcm_mutex);
+    ret = zg01_alloc_streaming(dev);
+    if (!ret)
+        ret = zg01_start_streaming(dev, NULL, -1);
+    mutex_unlock(&dev->pcm_mutex);
+    if (ret < 0)
+        zg01_shared_disarm(dev->shared, zg01_channel_iface(dev), &dev->preroll_armed);
+    return ret;
+}
+
+/*
+ * Start the always-on Voice In stream of the capture pre-roll; pins the
+ * clock at 48 kHz while the device is bound. Setting the rate waits for
+ * the shared context's bring-up, so this runs as a work item and never
+ * on the probe or resume path. Failure only costs the pre-roll.
+ */
+static void zg01_preroll_work(struct work_struct *work)
+{
+    struct zg01_dev *dev = container_of(work, struct zg01_dev, preroll_work);
+    struct zg01_preroll *pr = &dev->shared->preroll;
+    bool restart;
+    int ret;
+
+    /* Restart after a USB resume: the ring and the PM reference are still held */
+    mutex_lock(&dev->pcm_mutex);
+    restart = dev->preroll_suspended;
+    dev->preroll_suspended = false;
+    mutex_unlock(&dev->pcm_mutex);
+
+    if (restart) {
+        ret = zg01_preroll_run(dev);
+        if (ret < 0) {
+            usb_autopm_put_interface(dev->interface);
+            pr_warn("zg01_pcm: Capture pre-roll not restarted after resume: %d\n", ret);
+        }
+        return;
+    }
+
+    pr->frames = min(preroll_ms, ZG01_PREROLL_MAX_MS) * 48;
+    pr->frames = max(pr->frames - pr->frames % 6, 6U);
+    pr->buf = kvcalloc(pr->frames, sizeof(*pr->buf), GFP_KERNEL);
+    if (!pr->buf) {
+        pr_warn("zg01_pcm: No memory for %u ms capture pre-roll\n", preroll_ms);
+        return;
+    }
+
+    /* The always-on stream keeps the device out of autosuspend while bound */
+    ret = usb_autopm_get_interface(dev->interface);
+    if (ret < 0) {
+        pr_warn("zg01_pcm: Capture pre-roll not started: %d\n", ret);
+        return;
+    }
+
+    ret = zg01_shared_set_rate(dev->shared, ZG01_PKT_RATE, false);
+    if (!ret)
+        ret = zg01_preroll_run(dev);
+    if (ret < 0) {
+        usb_autopm_put_interface(dev->interface);
+        pr_warn("zg01_pcm: Capture pre-roll not started: %d\n", ret);
+        return;
+    }
+
+    pr_info("zg01_pcm: Voice In streaming into a %u ms capture pre-roll\n", pr->frames / 48);
+}
+
+/* Called once the card is registered: queue the pre-roll start behind the device bring-up */
+void zg01_preroll_start(struct zg01_dev *dev)
+{
+    if (!preroll_ms || raw_mode || dev->channel_type != CHANNEL_TYPE_VOICE_IN)
+        return;
+    schedule_work(&dev->preroll_work);
+}
+
+/* Disconnect: make sure a queued pre-roll start is not left running against a freed card */
+void zg01_free_pcm(struct zg01_dev *dev)
+{
+    cancel_work_sync(&dev->preroll_work);
+}
+
+EXPORT_SYMBOL_GPL(zg01_preroll_start);
+EXPORT_SYMBOL_GPL(zg01_free_pcm);
+
+/* Wait for the deferred URB cleanup of a stopped channel (bounded, ~100 ms) */
+static void zg01_wait_cleanup(struct zg01_dev *dev)
+{
+    bool *busy = dev->channel_type == CHANNEL_TYPE_GAME ? &dev->cleanup_in_progress_game :
+                 dev->channel_type == CHANNEL_TYPE_VOICE_IN ? &dev->cleanup_in_progress_voice :
+                 &dev->cleanup_in_progress_voice_out;
+    int i;
+
+    for (i = 0; i < 100 && READ_ONCE(*busy); i++)
+        usleep_range(1000, 2000);
+}
+
+/*
+ * USB suspend of the channel's interface: running streams are suspended
+ * through ALSA (their trigger stops the URBs), the pre-roll is stopped and
+ * remembered, and no URB is left in flight when this returns.
+ */
+void zg01_pcm_suspend(struct zg01_dev *dev)
+{
+    snd_pcm_suspend_all(dev->pcm.instance);
+
+    mutex_lock(&dev->pcm_mutex);
+    if (dev->preroll_armed) {
+        zg01_shared_disarm(dev->shared, zg01_channel_iface(dev), &dev->preroll_armed);
+        zg01_stop_streaming(dev);
+        dev->preroll_suspended = true;
+    }
+    mutex_unlock(&dev->pcm_mutex);
+
+    zg01_wait_cleanup(dev);
+}
+
+EXPORT_SYMBOL_GPL(zg01_pcm_suspend);
+
+/*
+ * USB resume: queue the pre-roll restart with an empty ring, so resume
+ * itself does no bus I/O for it. Suspended streams are restarted by user
+ * space through prepare, which finds the clock and alt settings already
+ * restored and starts on the next URB.
+ */
+void zg01_pcm_resume(struct zg01_dev *dev)
+{
+    struct zg01_preroll *pr = &dev->shared->preroll;
+    unsigned long flags;
+
+    if (!dev->preroll_suspended)
+        return;
+
+    spin_lock_irqsave(&dev->lock, flags);
+    pr->head = 0;
+    pr->filled = 0;
+    pr->pending = false;
+    spin_unlock_irqrestore(&dev->lock, flags);
+
+    schedule_work(&dev->preroll_work);
+}
+
+EXPORT_SYMBOL_GPL(zg01_pcm_resume);
+
 MODULE_AUTHOR("Your Name");
 MODULE_DESCRIPTION("Yamaha ZG01 USB Audio Driver - PCM Interface");
 MODULE_LICENSE("GPL");
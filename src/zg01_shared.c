@@ -0,0 +1,1196 @@
+/*
+ * Yamaha ZG01 USB Audio Driver - Shared Device Context
+ *
+ * The Game, Voice In and Voice Out cards of one ZG01 share a refcounted
+ * context that owns the streaming interface alt settings and the clock.
+ */
+
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/delay.h>
+#include <linux/usb/audio.h>
+#include <linux/usb/audio-v2.h>
+#include <sound/control.h>
+#include "zg01.h"
+#include "zg01_shared.h"
+
+static DEFINE_MUTEX(shared_list_mutex);
+static LIST_HEAD(shared_list);
+
+/* Caller holds sh->lock (or owns sh exclusively) */
+static int zg01_shared_set_alt(struct zg01_shared *sh, int iface, int alt)
+{
+    int ret;
+
+    /* The interrupt endpoint goes away with the alt setting */
+    if (iface == 2 && sh->notify.urb)
+        usb_kill_urb(sh->notify.urb);
+
+    ret = usb_set_interface(sh->udev, iface, alt);
+    if (ret < 0) {
+        dev_err(&sh->udev->dev, "Failed to set interface %d alt %d: %d\n",
+                iface, alt, ret);
+        sh->iface[iface].alt = -1;
+        return ret;
+    }
+
+    sh->iface[iface].alt = alt;
+    dev_dbg(&sh->udev->dev, "Set interface %d to alternate setting %d\n", iface, alt);
+
+    if (iface == 2 && alt == sh->notify.alt && sh->notify.urb) {
+        ret = usb_submit_urb(sh->notify.urb, GFP_KERNEL);
+        if (ret < 0)
+            dev_warn(&sh->udev->dev, "Failed to start the notification listener: %d\n", ret);
+    }
+    return 0;
+}
+
+/*
+ * Keep the device awake for bus I/O done outside a stream (bring-up,
+ * control cache, notifications). Returns the interface holding the
+ * reference, or NULL when none of ours is bound; the I/O goes ahead then.
+ */
+static struct usb_interface *zg01_shared_pm_get(struct zg01_shared *sh)
+{
+    int i;
+
+    for (i = 1; i < ZG01_NUM_IFACES; i++) {
+        struct usb_interface *intf = usb_ifnum_to_if(sh->udev, i);
+
+        if (intf && intf->dev.driver && !usb_autopm_get_interface(intf))
+            return intf;
+    }
+    return NULL;
+}
+
+static void zg01_shared_pm_put(struct usb_interface *intf)
+{
+    if (intf)
+        usb_autopm_put_interface(intf);
+}
+
+/*
+ * Bring a streaming interface to alt 1. The Windows driver activates
+ * playback as "interface 2 alt 0, interface 1 alt 1, interface 2 alt 1";
+ * keep that order when the capture interface is idle, but never cycle it
+ * while a Voice In stream is armed on it.
+ */
+static int zg01_shared_activate(struct zg01_shared *sh, int iface)
+{
+    bool cycle_capture = (iface == 1 && sh->iface[2].alt == 1 &&
+                          sh->iface[2].armed == 0);
+    int ret;
+
+    if (cycle_capture)
+        zg01_shared_set_alt(sh, 2, 0);
+
+    ret = zg01_shared_set_alt(sh, iface, 1);
+
+    if (cycle_capture)
+        zg01_shared_set_alt(sh, 2, 1);
+
+    return ret;
+}
+
+static int zg01_shared_magic_sequence(struct zg01_shared *sh, unsigned int rate);
+static void zg01_shared_read_rates(struct zg01_shared *sh);
+static void zg01_notify_init(struct zg01_shared *sh);
+static void zg01_notify_work(struct work_struct *work);
+static void zg01_notify_complete(struct urb *urb);
+static void zg01_hwctl_init(struct zg01_shared *sh);
+static void zg01_hwctl_read_all(struct zg01_shared *sh);
+static void zg01_hwctl_read_range(struct zg01_shared *sh);
+static void zg01_hwctl_flush(struct work_struct *work);
+
+/*
+ * Device bring-up off the probe path: the magic sequence takes several
+ * hundred ms of control transfers and settle delays, so run it once here
+ * and let the first prepare find the clock already configured. Probe does
+ * no bus I/O at all and the cards register while this runs; streams wait
+ * for it in zg01_shared_arm().
+ */
+static void zg01_shared_bringup_work(struct work_struct *work)
+{
+    struct zg01_shared *sh = container_of(work, struct zg01_shared, bringup_work);
+    struct usb_interface *pm = zg01_shared_pm_get(sh);
+
+    mutex_lock(&sh->lock);
+    if (!sh->clock_configured && sh->iface[1].armed + sh->iface[2].armed == 0)
+        zg01_shared_magic_sequence(sh, ZG01_DEFAULT_RATE);
+    zg01_shared_read_rates(sh);
+    zg01_hwctl_read_range(sh);
+    zg01_hwctl_read_all(sh);
+    mutex_unlock(&sh->lock);
+    zg01_shared_pm_put(pm);
+
+    complete_all(&sh->bringup_done);
+}
+
+static void zg01_shared_release(struct kref *kref)
+{
+    struct zg01_shared *sh = container_of(kref, struct zg01_shared, kref);
+
+    cancel_work_sync(&sh->bringup_work);
+    usb_kill_urb(sh->notify.urb);
+    cancel_work_sync(&sh->notify.work);
+    cancel_delayed_work_sync(&sh->hwctl.flush);
+    usb_free_urb(sh->notify.urb);
+    kfree(sh->notify.buf);
+    list_del(&sh->list);
+    usb_put_dev(sh->udev);
+    kvfree(sh->preroll.buf);
+    kvfree(sh);
+}
+
+/* Find or create the context of @udev and take a reference on it */
+struct zg01_shared *zg01_shared_get(struct usb_device *udev)
+{
+    struct zg01_shared *sh;
+
+    mutex_lock(&shared_list_mutex);
+
+    list_for_each_entry(sh, &shared_list, list) {
+        if (sh->udev == udev) {
+            kref_get(&sh->kref);
+            goto out;
+        }
+    }
+
+    sh = kvzalloc(sizeof(*sh), GFP_KERNEL); /* Carries the sidetone and mix rings */
+    if (!sh)
+        goto out;
+
+    kref_init(&sh->kref);
+    mutex_init(&sh->lock);
+    spin_lock_init(&sh->mix.lock);
+    sh->udev = usb_get_dev(udev);
+    sh->iface[1].alt = -1;
+    sh->iface[2].alt = -1;
+    /* No bus I/O here: the bring-up work resets both interfaces */
+
+    init_waitqueue_head(&sh->notify.wait);
+    spin_lock_init(&sh->notify.lock);
+    INIT_WORK(&sh->notify.work, zg01_notify_work);
+    zg01_notify_init(sh);
+    spin_lock_init(&sh->hwctl.lock);
+    INIT_DELAYED_WORK(&sh->hwctl.flush, zg01_hwctl_flush);
+    zg01_hwctl_init(sh);
+
+    list_add_tail(&sh->list, &shared_list);
+    dev_info(&udev->dev, "zg01_shared: Created shared device context\n");
+
+    INIT_WORK(&sh->bringup_work, zg01_shared_bringup_work);
+    init_completion(&sh->bringup_done);
+    schedule_work(&sh->bringup_work);
+
+out:
+    mutex_unlock(&shared_list_mutex);
+    return sh;
+}
+
+void zg01_shared_put(struct zg01_shared *sh)
+{
+    if (!sh)
+        return;
+
+    mutex_lock(&shared_list_mutex);
+    kref_put(&sh->kref, zg01_shared_release);
+    mutex_unlock(&shared_list_mutex);
+}
+
+/*
+ * Claim a streaming interface for an open stream. Bookkeeping only: the
+ * interface is activated lazily by zg01_shared_arm() when a stream is
+ * prepared, so the open/close probing of sound servers causes no bus I/O.
+ */
+int zg01_shared_iface_get(struct zg01_shared *sh, int iface)
+{
+    if (iface < 1 || iface >= ZG01_NUM_IFACES)
+        return -EINVAL;
+
+    mutex_lock(&sh->lock);
+    sh->iface[iface].users++;
+    mutex_unlock(&sh->lock);
+
+    return 0;
+}
+
+/* Drop an interface claim. The alt setting is left as is for the next open. */
+void zg01_shared_iface_put(struct zg01_shared *sh, int iface)
+{
+    if (iface < 1 || iface >= ZG01_NUM_IFACES)
+        return;
+
+    mutex_lock(&sh->lock);
+    if (sh->iface[iface].users > 0)
+        sh->iface[iface].users--;
+    mutex_unlock(&sh->lock);
+}
+
+/*
+ * Mark a stream as armed (prepared, URBs may be submitted at any time).
+ * From here on nobody may switch its interface or touch the clock.
+ */
+int zg01_shared_arm(struct zg01_shared *sh, int iface, bool *armed)
+{
+    int ret = 0;
+
+    if (iface < 1 || iface >= ZG01_NUM_IFACES)
+        return -EINVAL;
+
+    /* Let the bring-up settle the alt settings first */
+    wait_for_completion(&sh->bringup_done);
+
+    mutex_lock(&sh->lock);
+    if (!*armed) {
+        if (sh->iface[iface].alt != 1 && sh->iface[iface].armed == 0)
+            ret = zg01_shared_activate(sh, iface);
+        if (!ret) {
+            sh->iface[iface].armed++;
+            *armed = true;
+        }
+    }
+    mutex_unlock(&sh->lock);
+
+    return ret;
+}
+
+void zg01_shared_disarm(struct zg01_shared *sh, int iface, bool *armed)
+{
+    if (iface < 1 || iface >= ZG01_NUM_IFACES)
+        return;
+
+    mutex_lock(&sh->lock);
+    if (*armed) {
+        if (sh->iface[iface].armed > 0)
+            sh->iface[iface].armed--;
+        *armed = false;
+    }
+    mutex_unlock(&sh->lock);
+}
+
+/* One run of zg01_ctrl_run() */
+struct zg01_ctrl_ctx {
+    struct usb_anchor anchor;
+    spinlock_t lock;        /* Submitting against the first failure */
+    int failed;             /* Index of the first failed step, -1 while none */
+};
+
+/* One in-flight request of zg01_ctrl_run() */
+struct zg01_ctrl_xfer {
+    struct zg01_ctrl_ctx *ctx;
+    struct usb_ctrlrequest *setup;  /* Own allocation, apart from the data stage buffer */
+    struct zg01_ctrl_step *step;
+    unsigned int index;
+    u8 *buf;
+};
+
+static void zg01_ctrl_complete(struct urb *urb)
+{
+    struct zg01_ctrl_xfer *x = urb->context;
+    struct zg01_ctrl_ctx *ctx = x->ctx;
+    unsigned long flags;
+    bool first;
+
+    /* Killed on timeout: leave -ETIMEDOUT; unlinked behind a failed step: skipped */
+    if (urb->status == -ENOENT)
+        return;
+    if (urb->status == -ECONNRESET) {
+        x->step->status = -ECANCELED;
+        return;
+    }
+    x->step->status = urb->status ? urb->status : urb->actual_length;
+    if (!urb->status || x->step->independent)
+        return;
+
+    spin_lock_irqsave(&ctx->lock, flags);
+    first = ctx->failed < 0;
+    if (first)
+        ctx->failed = x->index;
+    spin_unlock_irqrestore(&ctx->lock, flags);
+
+    /* The endpoint queue waits for this handler, so nothing behind it has run yet */
+    if (first)
+        usb_unlink_anchored_urbs(&ctx->anchor);
+}
+
+static void zg01_ctrl_free_xfer(struct zg01_ctrl_xfer *x)
+{
+    if (!x)
+        return;
+    kfree(x->buf);
+    kfree(x->setup);
+    kfree(x);
+}
+
+/*
+ * Run a table of control requests as back-to-back async URBs with one
+ * wait at the end. Endpoint 0 completes them in order, so the deadline is
+ * the sum of the step budgets; steps still pending then are killed and
+ * report -ETIMEDOUT. A failing step stops the sequence: the steps after
+ * it are not sent and report -ECANCELED, unless it is marked independent
+ * (batches of unrelated requests). Results are decoded by the caller from
+ * each step's status and data. Returns 0, or the error of the step that
+ * stopped the sequence (or of the run itself). Sleeps.
+ */
+int zg01_ctrl_run(struct usb_device *udev, struct zg01_ctrl_step *steps, unsigned int n)
+{
+    struct zg01_ctrl_ctx ctx;
+    struct zg01_ctrl_xfer **xfers;
+    struct urb **urbs;
+    unsigned long flags;
+    unsigned int budget = 0;
+    unsigned int i, j;
+    int ret = 0;
+
+    urbs = kcalloc(n, sizeof(*urbs), GFP_KERNEL);
+    xfers = kcalloc(n, sizeof(*xfers), GFP_KERNEL);
+    if (!urbs || !xfers) {
+        kfree(urbs);
+        kfree(xfers);
+        return -ENOMEM;
+    }
+    init_usb_anchor(&ctx.anchor);
+    spin_lock_init(&ctx.lock);
+    ctx.failed = -1;
+    for (i = 0; i < n; i++)
+        steps[i].status = -ECANCELED;
+
+    for (i = 0; i < n; i++) {
+        struct zg01_ctrl_step *step = &steps[i];
+        bool in = step->request_type & USB_DIR_IN;
+        struct zg01_ctrl_xfer *x;
+
+        /* Setup packet and data stage in separate allocations, as usb_control_msg() does */
+        x = kzalloc(sizeof(*x), GFP_KERNEL);
+        if (x) {
+            x->setup = kmalloc(sizeof(*x->setup), GFP_KERNEL);
+            x->buf = step->length ? kmalloc(step->length, GFP_KERNEL) : NULL;
+        }
+        urbs[i] = usb_alloc_urb(0, GFP_KERNEL);
+        if (!x || !x->setup || (step->length && !x->buf) || !urbs[i]) {
+            usb_free_urb(urbs[i]);
+            urbs[i] = NULL;
+            zg01_ctrl_free_xfer(x);
+            ret = -ENOMEM;
+            break;
+        }
+        xfers[i] = x;
+
+        x->ctx = &ctx;
+        x->step = step;
+        x->index = i;
+        x->setup->bRequestType = step->request_type;
+        x->setup->bRequest = step->request;
+        x->setup->wValue = cpu_to_le16(step->value);
+        x->setup->wIndex = cpu_to_le16(step->index);
+        x->setup->wLength = cpu_to_le16(step->length);
+        if (!in && step->length)
+            memcpy(x->buf, step->data, step->length);
+
+        usb_fill_control_urb(urbs[i], udev,
+                             in ? usb_rcvctrlpipe(udev, 0) : usb_sndctrlpipe(udev, 0),
+                             (unsigned char *)x->setup, x->buf, step->length,
+                             zg01_ctrl_complete, x);
+
+        /* Nothing more goes out once a step has failed */
+        budget += step->timeout_ms;
+        spin_lock_irqsave(&ctx.lock, flags);
+        if (ctx.failed < 0) {
+            step->status = -ETIMEDOUT;
+            usb_anchor_urb(urbs[i], &ctx.anchor);
+            ret = usb_submit_urb(urbs[i], GFP_ATOMIC);
+            if (ret < 0) {
+                usb_unanchor_urb(urbs[i]);
+                step->status = ret;
+                ctx.failed = i;
+            }
+        }
+        spin_unlock_irqrestore(&ctx.lock, flags);
+        if (ctx.failed >= 0) {
+            i++;
+            break;
+        }
+    }
+
+    if (!usb_wait_anchor_empty_timeout(&ctx.anchor, budget)) {
+        usb_kill_anchored_urbs(&ctx.anchor);
+        if (!ret)
+            ret = -ETIMEDOUT;
+    }
+
+    if (ctx.failed >= 0) {
+        ret = steps[ctx.failed].status;
+        if (n > 1)
+            dev_warn(&udev->dev,
+                     "zg01_shared: Control sequence stopped at step %d of %u (0x%02x 0x%04x/0x%04x): %d\n",
+                     ctx.failed + 1, n, steps[ctx.failed].request, steps[ctx.failed].value,
+                     steps[ctx.failed].index, ret);
+    }
+
+    /* i is the number of steps set up (the failed one included) */
+    for (j = 0; j < i; j++) {
+        struct zg01_ctrl_xfer *x = xfers[j];
+
+        if (!x)
+            continue;
+        usb_kill_urb(urbs[j]);  /* Waits out an unlink behind a failed step */
+        if ((x->step->request_type & USB_DIR_IN) && x->step->status > 0)
+            memcpy(x->step->data, x->buf, x->step->status);
+        zg01_ctrl_free_xfer(x);
+        usb_free_urb(urbs[j]);
+    }
+    kfree(xfers);
+    kfree(urbs);
+    return ret;
+}
+
+/* UAC2 SAMPLING_FREQ_CONTROL of Clock Source 1 */
+#define ZG01_CTRL_CLOCK(dir, req, buf) \
+    { .request_type = (dir) | USB_TYPE_CLASS | USB_RECIP_INTERFACE, .request = (req), \
+      .value = 0x0100, .index = 0x0100, .length = 4, .timeout_ms = 1000, .data = (buf) }
+
+/* Wait up to @timeout_ms for a clock message after @seq; true if one arrived */
+static bool zg01_shared_clock_wait(struct zg01_shared *sh, unsigned int seq,
+                                   unsigned int timeout_ms)
+{
+    return wait_event_timeout(sh->notify.wait, READ_ONCE(sh->notify.clock_events) != seq,
+                              msecs_to_jiffies(timeout_ms)) > 0;
+}
+
+/* UAC2 Clock Source Control + extended vendor magic. Caller holds sh->lock. */
+static int zg01_shared_magic_sequence(struct zg01_shared *sh, unsigned int rate)
+{
+    struct usb_device *udev = sh->udev;
+    u8 wake[72];
+    u8 set_rate[4], cur_rate[4];
+    unsigned int seq;
+    int attempt;
+    int ret;
+
+    /* 1. Early Vendor Reads (Initialization/State discovery) */
+    /* Many Yamaha devices require these reads to move out of standby */
+    struct zg01_ctrl_step wake_steps[] = {
+        ZG01_CTRL_VENDOR_IN(0x07, 0x0000, 3),
+        ZG01_CTRL_VENDOR_IN(0x04, 0x0000, 1),
+        ZG01_CTRL_VENDOR_IN(0x0a, 0x0000, 4),
+        ZG01_CTRL_VENDOR_IN(0x0c, 0x8000, 72),
+        ZG01_CTRL_VENDOR_IN(0x0c, 0x0000, 72),
+    };
+    /* 3. Set UAC2 Rate on Clock Source 1 and read it back */
+    struct zg01_ctrl_step rate_steps[] = {
+        ZG01_CTRL_CLOCK(USB_DIR_OUT, 0x01 /* SET_CUR */, set_rate),
+        ZG01_CTRL_CLOCK(USB_DIR_IN, 0x01 /* GET_CUR */, cur_rate),
+    };
+    /* 4. Complete Handshake/Commit: 0xC0 2/2, 0xC0 2/1, 0xC0 8/0, 0x41 0/0 */
+    struct zg01_ctrl_step commit_steps[] = {
+        ZG01_CTRL_VENDOR_IN(0x02, 0x0002, 1),
+        ZG01_CTRL_VENDOR_IN(0x02, 0x0001, 1),
+        ZG01_CTRL_VENDOR_IN(0x08, 0x0000, 1),
+        { .request_type = USB_DIR_OUT | USB_TYPE_VENDOR | USB_RECIP_INTERFACE,
+          .request = 0x00, .timeout_ms = 1000 },
+    };
+    unsigned int i;
+
+    for (i = 0; i < ARRAY_SIZE(wake_steps); i++)
+        wake_steps[i].data = wake;
+    for (i = 0; i < 3; i++)
+        commit_steps[i].data = wake;
+
+    pr_info("zg01_shared: Starting extended Magic Sequence for %u Hz\n", rate);
+    sh->clock_configured = false;
+
+    ret = zg01_ctrl_run(udev, wake_steps, ARRAY_SIZE(wake_steps));
+    if (ret == -ENOMEM)
+        return ret;
+
+    /* 2. Set Interfaces 1 and 2 to Alt 0 (no stream is armed, see caller) */
+    pr_info("zg01_shared: Resetting interfaces to Alt 0\n");
+    zg01_shared_set_alt(sh, 1, 0);
+    zg01_shared_set_alt(sh, 2, 0);
+
+    set_rate[0] = rate & 0xff;
+    set_rate[1] = (rate >> 8) & 0xff;
+    set_rate[2] = (rate >> 16) & 0xff;
+    set_rate[3] = (rate >> 24) & 0xff;
+
+    /* SET_CUR and GET_CUR go out back to back; retry if the read back fails */
+    for (attempt = 1; attempt <= 3; attempt++) {
+        zg01_ctrl_run(udev, rate_steps, ARRAY_SIZE(rate_steps));
+
+        if (rate_steps[0].status < 0)
+            pr_err("zg01_shared: Attempt %d: Failed to set UAC2 rate: %d\n",
+                   attempt, rate_steps[0].status);
+
+        if (rate_steps[1].status == 4) {
+            unsigned int ret_rate = cur_rate[0] | (cur_rate[1] << 8) |
+                                    (cur_rate[2] << 16) | (cur_rate[3] << 24);
+
+            pr_info("zg01_shared: GET_CUR reported rate: %u (requested %u)\n", ret_rate, rate);
+            /* Treat the device-reported rate as authoritative */
+            sh->rate = ret_rate;
+            if (ret_rate != rate)
+                pr_warn("zg01_shared: Device reported different rate (%u) than requested (%u); using device rate\n",
+                        ret_rate, rate);
+            ret = 0;
+            break;
+        }
+
+        pr_warn("zg01_shared: Failed to read back sampling freq (rc=%d)\n", rate_steps[1].status);
+        ret = rate_steps[1].status < 0 ? rate_steps[1].status : -EIO;
+
+        /* Small pause to let device settle. The interrupt endpoint is down
+         * while the interfaces are parked, so there is nothing to wait on. */
+        if (attempt < 3)
+            msleep(150);
+    }
+
+    pr_info("zg01_shared: Finalizing handshake (Vendor 0xC0/0x41)\n");
+    zg01_ctrl_run(udev, commit_steps, ARRAY_SIZE(commit_steps));
+
+    /* 5. Restore Streaming Interfaces (Alt 1); this also starts the listener */
+    pr_info("zg01_shared: Activating interfaces (Alt 1)\n");
+    seq = READ_ONCE(sh->notify.clock_events);
+    zg01_shared_set_alt(sh, 1, 1);
+    zg01_shared_set_alt(sh, 2, 1);
+
+    /* Give device time to stabilize; its clock message ends the wait early */
+    if (!zg01_shared_clock_wait(sh, seq, 200))
+        pr_debug("zg01_shared: No clock notification, settled on the timeout\n");
+    sh->clock_configured = (ret == 0);
+    pr_info("zg01_shared: Magic Sequence complete, device should be ready\n");
+
+    return ret;
+}
+
+/*
+ * Ask Clock Source 1 for its rates (UAC2 RANGE: wNumSubRanges, then
+ * MIN/MAX/RES triplets) and keep them as a discrete list for the PCM
+ * hw rules. Caller holds sh->lock.
+ */
+static void zg01_shared_read_rates(struct zg01_shared *sh)
+{
+    u8 buf[2 + 12 * ZG01_MAX_RATES];
+    struct zg01_ctrl_step step = ZG01_CTRL_CLOCK(USB_DIR_IN, 0x02 /* RANGE */, buf);
+    unsigned int n, i;
+
+    step.length = sizeof(buf);
+    zg01_ctrl_run(sh->udev, &step, 1);
+    if (step.status < 2) {
+        pr_warn("zg01_shared: Clock RANGE request failed: %d\n", step.status);
+        return;
+    }
+
+    n = min_t(unsigned int, buf[0] | (buf[1] << 8), (step.status - 2) / 12);
+    sh->nr_rates = 0;
+    for (i = 0; i < n; i++) {
+        const u8 *r = buf + 2 + 12 * i;
+        u32 lo = r[0] | (r[1] << 8) | (r[2] << 16) | (r[3] << 24);
+        u32 hi = r[4] | (r[5] << 8) | (r[6] << 16) | (r[7] << 24);
+        u32 res = r[8] | (r[9] << 8) | (r[10] << 16) | (r[11] << 24);
+        u32 rate;
+
+        for (rate = lo; rate <= hi && sh->nr_rates < ZG01_MAX_RATES; rate += res) {
+            sh->rates[sh->nr_rates++] = rate;
+            if (!res || hi - rate < res)
+                break;
+        }
+    }
+    pr_info("zg01_shared: Clock source reports %u rate(s), first %u Hz\n",
+            sh->nr_rates, sh->nr_rates ? sh->rates[0] : 0);
+}
+
+/* Entity ID of Clock Source 1 (wIndex high byte of its requests) */
+#define ZG01_CLOCK_ID 0x01
+
+/* Look up the interrupt endpoint and set up its URB; no bus I/O */
+static void zg01_notify_init(struct zg01_shared *sh)
+{
+    struct zg01_notify *nt = &sh->notify;
+    struct usb_endpoint_descriptor *ep;
+    struct usb_host_interface *alt;
+    struct usb_interface *intf;
+    unsigned int len;
+    int i;
+
+    intf = usb_ifnum_to_if(sh->udev, 2);
+    if (!intf)
+        return;
+
+    for (i = 0; i < intf->num_altsetting; i++) {
+        alt = &intf->altsetting[i];
+        if (!usb_find_int_in_endpoint(alt, &ep))
+            break;
+    }
+    if (i == intf->num_altsetting) {
+        dev_info(&sh->udev->dev, "zg01_shared: No interrupt endpoint, using fixed delays\n");
+        return;
+    }
+
+    len = max_t(unsigned int, usb_endpoint_maxp(ep), sizeof(struct uac2_interrupt_data_msg));
+    nt->buf = kmalloc(len, GFP_KERNEL);
+    nt->urb = usb_alloc_urb(0, GFP_KERNEL);
+    if (!nt->buf || !nt->urb) {
+        usb_free_urb(nt->urb);
+        kfree(nt->buf);
+        nt->urb = NULL;
+        nt->buf = NULL;
+        return;
+    }
+
+    nt->alt = alt->desc.bAlternateSetting;
+    usb_fill_int_urb(nt->urb, sh->udev, usb_rcvintpipe(sh->udev, ep->bEndpointAddress),
+                     nt->buf, len, zg01_notify_complete, sh, ep->bInterval);
+}
+
+/*
+ * A UAC2 interrupt message names the control that changed, not its value.
+ * Clock messages only wake waiters; controls are read back by the work.
+ * Control selectors overlap between unit types (the selector unit's is the
+ * feature unit mute's), so a message is only taken for a device control
+ * when both its entity and its selector match one the descriptors gave us.
+ */
+static void zg01_notify_complete(struct urb *urb)
+{
+    struct zg01_shared *sh = urb->context;
+    struct zg01_notify *nt = &sh->notify;
+    struct uac2_interrupt_data_msg *msg = urb->transfer_buffer;
+    unsigned long flags;
+    u16 value, index;
+    int what = -1;
+    int ret;
+
+    switch (urb->status) {
+    case 0:
+        break;
+    case -ENOENT:
+    case -ECONNRESET:
+    case -ESHUTDOWN:
+    case -ENODEV:
+        return; /* Killed for an alt switch, or the device is gone */
+    default:
+        goto resubmit;
+    }
+
+    /* Only class messages about an entity (bInfo bits 0-1 clear) */
+    if (urb->actual_length < sizeof(*msg) || (msg->bInfo & 0x03))
+        goto resubmit;
+
+    value = le16_to_cpu(msg->wValue);
+    index = le16_to_cpu(msg->wIndex);
+
+    if ((index >> 8) == ZG01_CLOCK_ID) {
+        WRITE_ONCE(nt->clock_events, nt->clock_events + 1);
+        wake_up_all(&nt->wait);
+        if ((value >> 8) == UAC2_CS_CONTROL_SAM_FREQ)
+            what = ZG01_NOTIFY_RATE;
+    } else {
+        static const int notify_of[ZG01_HWCTL_NR] = {
+            [ZG01_HWCTL_MUTE] = ZG01_NOTIFY_MUTE,
+            [ZG01_HWCTL_VOLUME] = ZG01_NOTIFY_VOLUME,
+            [ZG01_HWCTL_MIC_SELECT] = ZG01_NOTIFY_MIC_SELECT,
+        };
+        struct zg01_hwctl *hc = &sh->hwctl;
+        int id;
+
+        for (id = 0; id < ZG01_HWCTL_NR; id++) {
+            if (hc->windex[id] && (index >> 8) == (hc->windex[id] >> 8) &&
+                (value >> 8) == (hc->wvalue[id] >> 8)) {
+                what = notify_of[id];
+                break;
+            }
+        }
+    }
+
+    if (what >= 0) {
+        spin_lock_irqsave(&nt->lock, flags);
+        nt->control[what].value = value;
+        nt->control[what].index = index;
+        __set_bit(what, &nt->pending);
+        spin_unlock_irqrestore(&nt->lock, flags);
+        schedule_work(&nt->work);
+    }
+
+resubmit:
+    ret = usb_submit_urb(urb, GFP_ATOMIC);
+    if (ret < 0 && ret != -ENODEV && ret != -EPERM)
+        dev_dbg(&sh->udev->dev, "zg01_shared: Listener resubmit failed: %d\n", ret);
+}
+
+/* GET_CUR of the control a message named; returns bytes read or -errno */
+static int zg01_notify_read(struct zg01_shared *sh, int what, void *buf, u16 len)
+{
+    struct zg01_ctrl_step step = {
+        .request_type = USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+        .request = UAC2_CS_CUR, .length = len, .timeout_ms = 1000, .data = buf,
+    };
+    unsigned long flags;
+
+    spin_lock_irqsave(&sh->notify.lock, flags);
+    step.value = sh->notify.control[what].value;
+    step.index = sh->notify.control[what].index;
+    spin_unlock_irqrestore(&sh->notify.lock, flags);
+
+    zg01_ctrl_run(sh->udev, &step, 1);
+    return step.status;
+}
+
+/* Take a value the device reported unless a write of ours is still pending */
+static void zg01_hwctl_update(struct zg01_shared *sh, int id, int value)
+{
+    struct zg01_hwctl *hc = &sh->hwctl;
+    unsigned long flags;
+
+    spin_lock_irqsave(&hc->lock, flags);
+    if (!test_bit(id, &hc->dirty) && hc->value[id] != value) {
+        hc->value[id] = value;
+        if (hc->card && hc->kctl[id])
+            snd_ctl_notify(hc->card, SNDRV_CTL_EVENT_MASK_VALUE, &hc->kctl[id]->id);
+    }
+    spin_unlock_irqrestore(&hc->lock, flags);
+}
+
+static void zg01_notify_work(struct work_struct *work)
+{
+    struct zg01_shared *sh = container_of(work, struct zg01_shared, notify.work);
+    struct zg01_notify *nt = &sh->notify;
+    struct usb_interface *pm;
+    unsigned long flags, pending;
+    u8 buf[4];
+
+    spin_lock_irqsave(&nt->lock, flags);
+    pending = nt->pending;
+    nt->pending = 0;
+    spin_unlock_irqrestore(&nt->lock, flags);
+
+    pm = zg01_shared_pm_get(sh);
+
+    if (test_bit(ZG01_NOTIFY_RATE, &pending) && zg01_notify_read(sh, ZG01_NOTIFY_RATE, buf, 4) == 4) {
+        unsigned int rate = buf[0] | (buf[1] << 8) | (buf[2] << 16) | (buf[3] << 24);
+
+        /* Serialized against the magic sequence; the next set_rate sees the real rate */
+        mutex_lock(&sh->lock);
+        if (rate != sh->rate) {
+            pr_info("zg01_shared: Device clock changed from %u to %u Hz\n", sh->rate, rate);
+            sh->rate = rate;
+        }
+        mutex_unlock(&sh->lock);
+    }
+
+    if (test_bit(ZG01_NOTIFY_MUTE, &pending) && zg01_notify_read(sh, ZG01_NOTIFY_MUTE, buf, 1) == 1)
+        zg01_hwctl_update(sh, ZG01_HWCTL_MUTE, buf[0] != 0);
+
+    if (test_bit(ZG01_NOTIFY_VOLUME, &pending) && zg01_notify_read(sh, ZG01_NOTIFY_VOLUME, buf, 2) == 2)
+        zg01_hwctl_update(sh, ZG01_HWCTL_VOLUME, (s16)(buf[0] | (buf[1] << 8)));
+
+    /* Selector units count their inputs from 1 */
+    if (test_bit(ZG01_NOTIFY_MIC_SELECT, &pending) &&
+        zg01_notify_read(sh, ZG01_NOTIFY_MIC_SELECT, buf, 1) == 1)
+        zg01_hwctl_update(sh, ZG01_HWCTL_MIC_SELECT, buf[0] ? buf[0] - 1 : 0);
+
+    zg01_shared_pm_put(pm);
+}
+
+/* Coalescing window of control writes: one batch per window at most */
+#define ZG01_HWCTL_FLUSH_MS 20
+
+/* Payload length of each device control */
+static const u8 zg01_hwctl_len[ZG01_HWCTL_NR] = {
+    [ZG01_HWCTL_MUTE] = 1,
+    [ZG01_HWCTL_VOLUME] = 2,
+    [ZG01_HWCTL_MIC_SELECT] = 1,
+};
+
+/*
+ * Find the device controls in the AudioControl interface descriptors: the
+ * first Feature Unit carries mute and volume, a Selector Unit with two or
+ * more inputs picks the mic source. No bus I/O.
+ */
+static void zg01_hwctl_init(struct zg01_shared *sh)
+{
+    struct zg01_hwctl *hc = &sh->hwctl;
+    struct usb_interface *intf = usb_ifnum_to_if(sh->udev, 0);
+    const u8 *p, *end;
+
+    /* Until the device reports its range: -60 to 0 dB in 0.5 dB steps */
+    hc->vol_min = -60 * 256;
+    hc->vol_max = 0;
+    hc->vol_res = 128;
+
+    if (!intf || !intf->altsetting[0].extra)
+        return;
+
+    p = intf->altsetting[0].extra;
+    end = p + intf->altsetting[0].extralen;
+    for (; p + 5 <= end && p[0] >= 5 && p + p[0] <= end; p += p[0]) {
+        if (p[1] != USB_DT_CS_INTERFACE)
+            continue;
+
+        if (p[2] == UAC_FEATURE_UNIT && !hc->windex[ZG01_HWCTL_MUTE]) {
+            hc->windex[ZG01_HWCTL_MUTE] = p[3] << 8;
+            hc->wvalue[ZG01_HWCTL_MUTE] = UAC_FU_MUTE << 8;
+            hc->windex[ZG01_HWCTL_VOLUME] = p[3] << 8;
+            hc->wvalue[ZG01_HWCTL_VOLUME] = UAC_FU_VOLUME << 8;
+        } else if (p[2] == UAC_SELECTOR_UNIT && p[4] >= 2 && !hc->windex[ZG01_HWCTL_MIC_SELECT]) {
+            hc->windex[ZG01_HWCTL_MIC_SELECT] = p[3] << 8;
+            hc->wvalue[ZG01_HWCTL_MIC_SELECT] = UAC2_SU_SELECTOR << 8;
+        }
+    }
+
+    dev_info(&sh->udev->dev, "zg01_shared: Feature unit %u, selector unit %u\n",
+             hc->windex[ZG01_HWCTL_MUTE] >> 8, hc->windex[ZG01_HWCTL_MIC_SELECT] >> 8);
+}
+
+/* Selector units count their inputs from 1 */
+static u16 zg01_hwctl_wire(int id, int value)
+{
+    return id == ZG01_HWCTL_MIC_SELECT ? value + 1 : (u16)value;
+}
+
+/*
+ * Ask the feature unit for the knob's volume range (one subrange of
+ * min/max/res, 1/256 dB) and let mixers know the control's scale changed.
+ * A missing or nonsensical answer keeps the default range. Caller holds sh->lock.
+ */
+static void zg01_hwctl_read_range(struct zg01_shared *sh)
+{
+    struct zg01_hwctl *hc = &sh->hwctl;
+    u8 buf[8];
+    struct zg01_ctrl_step step = {
+        .request_type = USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+        .request = UAC2_CS_RANGE, .value = hc->wvalue[ZG01_HWCTL_VOLUME],
+        .index = hc->windex[ZG01_HWCTL_VOLUME], .length = sizeof(buf), .timeout_ms = 1000,
+        .data = buf,
+    };
+    unsigned long flags;
+    int min, max, res;
+
+    if (!hc->windex[ZG01_HWCTL_VOLUME])
+        return;
+
+    zg01_ctrl_run(sh->udev, &step, 1);
+    if (step.status != sizeof(buf) || !(buf[0] | (buf[1] << 8)))
+        return;
+    min = (s16)(buf[2] | (buf[3] << 8));
+    max = (s16)(buf[4] | (buf[5] << 8));
+    res = buf[6] | (buf[7] << 8);
+    if (res <= 0 || max <= min || (max - min) / res > 1024) {
+        dev_warn(&sh->udev->dev, "zg01_shared: Ignoring volume range %d..%d/%d\n", min, max, res);
+        return;
+    }
+
+    spin_lock_irqsave(&hc->lock, flags);
+    hc->vol_min = min;
+    hc->vol_max = min + (max - min) / res * res;
+    hc->vol_res = res;
+    if (hc->card && hc->kctl[ZG01_HWCTL_VOLUME])
+        snd_ctl_notify(hc->card, SNDRV_CTL_EVENT_MASK_INFO | SNDRV_CTL_EVENT_MASK_TLV,
+                       &hc->kctl[ZG01_HWCTL_VOLUME]->id);
+    spin_unlock_irqrestore(&hc->lock, flags);
+}
+
+/* Fill the cache from the device in one batch. Caller holds sh->lock. */
+static void zg01_hwctl_read_all(struct zg01_shared *sh)
+{
+    struct zg01_hwctl *hc = &sh->hwctl;
+    struct zg01_ctrl_step steps[ZG01_HWCTL_NR];
+    u8 data[ZG01_HWCTL_NR][2] = {};
+    int ids[ZG01_HWCTL_NR];
+    unsigned int n = 0, i;
+
+    for (i = 0; i < ZG01_HWCTL_NR; i++) {
+        if (!hc->windex[i])
+            continue;
+        steps[n] = (struct zg01_ctrl_step) {
+            .request_type = USB_DIR_IN | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+            .request = UAC2_CS_CUR, .value = hc->wvalue[i], .index = hc->windex[i],
+            .length = zg01_hwctl_len[i], .timeout_ms = 1000, .independent = true,
+            .data = data[n],
+        };
+        ids[n++] = i;
+    }
+    if (!n)
+        return;
+
+    zg01_ctrl_run(sh->udev, steps, n);
+    for (i = 0; i < n; i++) {
+        int id = ids[i];
+        int value = data[i][0] | (data[i][1] << 8);
+
+        if (steps[i].status != zg01_hwctl_len[id])
+            continue;
+        if (id == ZG01_HWCTL_VOLUME)
+            value = (s16)value;
+        else if (id == ZG01_HWCTL_MIC_SELECT)
+            value = value ? value - 1 : 0;
+        zg01_hwctl_update(sh, id, value);
+    }
+}
+
+/*
+ * Send every dirty control in one batch. Holding sh->lock keeps the burst
+ * out of the magic sequence and out of a prepare's alt setting switch.
+ */
+static void zg01_hwctl_flush(struct work_struct *work)
+{
+    struct zg01_shared *sh = container_of(to_delayed_work(work), struct zg01_shared,
+                                          hwctl.flush);
+    struct zg01_hwctl *hc = &sh->hwctl;
+    struct zg01_ctrl_step steps[ZG01_HWCTL_NR];
+    u8 data[ZG01_HWCTL_NR][2];
+    struct usb_interface *pm = zg01_shared_pm_get(sh);
+    unsigned long flags, dirty;
+    unsigned int n = 0, i;
+    int id;
+
+    mutex_lock(&sh->lock);
+
+    spin_lock_irqsave(&hc->lock, flags);
+    dirty = hc->dirty;
+    hc->dirty = 0;
+    for_each_set_bit(id, &dirty, ZG01_HWCTL_NR) {
+        u16 wire = zg01_hwctl_wire(id, hc->value[id]);
+
+        data[n][0] = wire & 0xff;
+        data[n][1] = wire >> 8;
+        steps[n] = (struct zg01_ctrl_step) {
+            .request_type = USB_DIR_OUT | USB_TYPE_CLASS | USB_RECIP_INTERFACE,
+            .request = UAC2_CS_CUR, .value = hc->wvalue[id], .index = hc->windex[id],
+            .length = zg01_hwctl_len[id], .timeout_ms = 1000, .independent = true,
+            .data = data[n],
+        };
+        n++;
+    }
+    spin_unlock_irqrestore(&hc->lock, flags);
+
+    if (n)
+        zg01_ctrl_run(sh->udev, steps, n);
+    mutex_unlock(&sh->lock);
+    zg01_shared_pm_put(pm);
+
+    for (i = 0; i < n; i++)
+        if (steps[i].status < 0)
+            dev_warn(&sh->udev->dev, "zg01_shared: Control write 0x%04x/0x%04x failed: %d\n",
+                     steps[i].value, steps[i].index, steps[i].status);
+}
+
+bool zg01_shared_hwctl_present(struct zg01_shared *sh, int id)
+{
+    return id >= 0 && id < ZG01_HWCTL_NR && sh->hwctl.windex[id];
+}
+
+/* Cached value; never touches the bus */
+int zg01_shared_hwctl_get(struct zg01_shared *sh, int id)
+{
+    unsigned long flags;
+    int value;
+
+    spin_lock_irqsave(&sh->hwctl.lock, flags);
+    value = sh->hwctl.value[id];
+    spin_unlock_irqrestore(&sh->hwctl.lock, flags);
+    return value;
+}
+
+/* Knob volume range in 1/256 dB: the device's once bring-up has read it */
+void zg01_shared_hwctl_range(struct zg01_shared *sh, int *min, int *max, int *res)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&sh->hwctl.lock, flags);
+    *min = sh->hwctl.vol_min;
+    *max = sh->hwctl.vol_max;
+    *res = sh->hwctl.vol_res;
+    spin_unlock_irqrestore(&sh->hwctl.lock, flags);
+}
+
+/*
+ * Update the cache and queue the write. Writes within a flush window
+ * coalesce: only the last value of each control goes out. Returns 1 if
+ * the value changed.
+ */
+int zg01_shared_hwctl_put(struct zg01_shared *sh, int id, int value)
+{
+    struct zg01_hwctl *hc = &sh->hwctl;
+    unsigned long flags;
+    int changed;
+
+    spin_lock_irqsave(&hc->lock, flags);
+    changed = hc->value[id] != value;
+    if (changed) {
+        hc->value[id] = value;
+        __set_bit(id, &hc->dirty);
+    }
+    spin_unlock_irqrestore(&hc->lock, flags);
+
+    if (changed)
+        schedule_delayed_work(&hc->flush, msecs_to_jiffies(ZG01_HWCTL_FLUSH_MS));
+    return changed;
+}
+
+/*
+ * Set (or with a NULL card, clear) the control that gets a change event
+ * when the device reports a new value for @id.
+ */
+void zg01_shared_hwctl_attach(struct zg01_shared *sh, int id, struct snd_card *card,
+                              struct snd_kcontrol *kctl)
+{
+    unsigned long flags;
+
+    spin_lock_irqsave(&sh->hwctl.lock, flags);
+    sh->hwctl.card = card;
+    sh->hwctl.kctl[id] = kctl;
+    spin_unlock_irqrestore(&sh->hwctl.lock, flags);
+}
+
+/*
+ * Interface @iface is about to suspend: the listener (on interface 2) is
+ * stopped. Control writes still queued hold off an autosuspend; a system
+ * suspend leaves them dirty for resume. The control works are never
+ * waited for here, they may be waiting for this very suspend to finish.
+ */
+int zg01_shared_suspend(struct zg01_shared *sh, int iface, bool autosuspend)
+{
+    if (autosuspend && (READ_ONCE(sh->hwctl.dirty) || delayed_work_pending(&sh->hwctl.flush)))
+        return -EBUSY;
+
+    cancel_delayed_work(&sh->hwctl.flush);
+    if (iface == 2)
+        usb_kill_urb(sh->notify.urb);
+    return 0;
+}
+
+/*
+ * Interface @iface resumed. After a plain resume the device kept its
+ * state and the cache still matches it: only restart the listener, so an
+ * autoresume (a PCM open) costs no control traffic at all. After a
+ * reset resume put the cached clock rate and alt setting back with one
+ * SET_CUR and one SET_INTERFACE instead of the full magic sequence, and
+ * replay the control cache. Streams restart on their next prepare.
+ * Returns the error of a listener that could not be restarted.
+ */
+int zg01_shared_resume(struct zg01_shared *sh, int iface, bool reset)
+{
+    struct zg01_hwctl *hc = &sh->hwctl;
+    unsigned long flags;
+    int i, ret = 0;
+
+    mutex_lock(&sh->lock);
+    if (reset) {
+        if (sh->clock_configured) {
+            u8 cur[4] = { sh->rate & 0xff, (sh->rate >> 8) & 0xff,
+                          (sh->rate >> 16) & 0xff, (sh->rate >> 24) & 0xff };
+            struct zg01_ctrl_step step = ZG01_CTRL_CLOCK(USB_DIR_OUT, 0x01 /* SET_CUR */, cur);
+
+            zg01_ctrl_run(sh->udev, &step, 1);
+            if (step.status < 0) {
+                pr_warn("zg01_shared: Clock not restored (%d), next prepare reconfigures it\n",
+                        step.status);
+                sh->clock_configured = false;
+            }
+        }
+        if (sh->iface[iface].alt >= 0)
+            zg01_shared_set_alt(sh, iface, sh->iface[iface].alt);
+
+        spin_lock_irqsave(&hc->lock, flags);
+        for (i = 0; i < ZG01_HWCTL_NR; i++)
+            if (hc->windex[i])
+                __set_bit(i, &hc->dirty);
+        spin_unlock_irqrestore(&hc->lock, flags);
+    } else {
+        if (iface == 2 && sh->iface[2].alt == sh->notify.alt && sh->notify.urb) {
+            ret = usb_submit_urb(sh->notify.urb, GFP_NOIO);
+            if (ret < 0)
+                dev_warn(&sh->udev->dev, "Failed to restart the notification listener: %d\n", ret);
+        }
+    }
+    mutex_unlock(&sh->lock);
+
+    if (READ_ONCE(hc->dirty))
+        schedule_delayed_work(&hc->flush, 0);
+    return ret;
+}
+
+/*
+ * Make sure the device clock runs at @rate. This is a no-op when the clock
+ * is already configured at that rate, so a second stream opening never
+ * reruns the magic sequence under a running one. Switching to another rate
+ * is refused with -EBUSY while any other stream is armed. Waits for the
+ * probe-time bring-up if it is still running.
+ */
+int zg01_shared_set_rate(struct zg01_shared *sh, unsigned int rate, bool self_armed)
+{
+    int others;
+    int ret;
+
+    wait_for_completion(&sh->bringup_done);
+    mutex_lock(&sh->lock);
+
+    if (sh->clock_configured && sh->rate == rate) {
+        ret = 0;
+        goto out;
+    }
+
+    others = sh->iface[1].armed + sh->iface[2].armed - (self_armed ? 1 : 0);
+    if (others > 0) {
+        pr_warn("zg01_shared: Clock busy at %u Hz with %d armed stream(s), not switching to %u Hz\n",
+                sh->rate, others, rate);
+        ret = -EBUSY;
+        goto out;
+    }
+
+    ret = zg01_shared_magic_sequence(sh, rate);
+
+out:
+    mutex_unlock(&sh->lock);
+    return ret;
+}
+
+/*
+ * Clock rate the device last reported (GET_CUR during bring-up or a rate
+ * change). Served from the cache without bus I/O or taking sh->lock, so
+ * hw_params stays cheap and never waits behind a running magic sequence.
+ */
+int zg01_shared_read_rate(struct zg01_shared *sh, unsigned int *rate)
+{
+    if (!READ_ONCE(sh->clock_configured))
+        return -ENODATA;
+    *rate = READ_ONCE(sh->rate);
+    return 0;
+}
+
+/*
+ * Rate the clock is pinned at by armed streams other than the caller, or 0
+ * when the next prepare may still switch it. Lockless, for hw rules.
+ */
+unsigned int zg01_shared_locked_rate(struct zg01_shared *sh, bool self_armed)
+{
+    int others = READ_ONCE(sh->iface[1].armed) + READ_ONCE(sh->iface[2].armed) -
+                 (self_armed ? 1 : 0);
+
+    if (others <= 0 || !READ_ONCE(sh->clock_configured))
+        return 0;
+    return READ_ONCE(sh->rate);
+}
+
+EXPORT_SYMBOL_GPL(zg01_shared_get);
+EXPORT_SYMBOL_GPL(zg01_shared_put);
+EXPORT_SYMBOL_GPL(zg01_shared_iface_get);
+EXPORT_SYMBOL_GPL(zg01_shared_iface_put);
+EXPORT_SYMBOL_GPL(zg01_shared_arm);
+EXPORT_SYMBOL_GPL(zg01_shared_disarm);
+EXPORT_SYMBOL_GPL(zg01_shared_set_rate);
+EXPORT_SYMBOL_GPL(zg01_shared_read_rate);
+EXPORT_SYMBOL_GPL(zg01_ctrl_run);
+EXPORT_SYMBOL_GPL(zg01_shared_locked_rate);
+EXPORT_SYMBOL_GPL(zg01_shared_hwctl_present);
+EXPORT_SYMBOL_GPL(zg01_shared_hwctl_get);
+EXPORT_SYMBOL_GPL(zg01_shared_hwctl_put);
+EXPORT_SYMBOL_GPL(zg01_shared_hwctl_range);
+EXPORT_SYMBOL_GPL(zg01_shared_hwctl_attach);
+EXPORT_SYMBOL_GPL(zg01_shared_suspend);
+EXPORT_SYMBOL_GPL(zg01_shared_resume);
+
+MODULE_AUTHOR("Your Name");
+MODULE_DESCRIPTION("Yamaha ZG01 USB Audio Driver - Shared Device Context");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,224 @@
+#ifndef ZG01_SHARED_H
+#define ZG01_SHARED_H
+
+#include <linux/completion.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/spinlock.h>
+#include <linux/usb.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+struct zg01_dev;
+struct snd_card;
+struct snd_kcontrol;
+
+/* Channel slots in the shared context (indexed by CHANNEL_TYPE_*) */
+#define ZG01_NUM_CHANNELS 3
+
+/* Clock rate the device is brought up at when it is plugged in */
+#define ZG01_DEFAULT_RATE 48000
+
+/* Discrete clock rates kept from the UAC2 RANGE reply */
+#define ZG01_MAX_RATES 8
+
+/* Streaming interfaces arbitrated by the shared context (1 = playback, 2 = capture) */
+#define ZG01_NUM_IFACES 3
+
+/* Sidetone ring length in frames (power of two, ~21 ms at 48 kHz) */
+#define ZG01_SIDETONE_FRAMES 1024
+
+/*
+ * Sidetone ring: the Voice In completion is the only producer, each
+ * playback packer consumes with its own read position. Lock-free: the
+ * producer publishes 'head' with release semantics and never waits;
+ * consumers stay close enough behind it not to read slots being rewritten.
+ */
+struct zg01_sidetone {
+    s32 buf[ZG01_SIDETONE_FRAMES][2];
+    unsigned int head;      /* Frames produced so far (wraps) */
+    unsigned int rate;      /* Rate of the capture stream feeding the ring */
+};
+
+/* Stream mix ring: 128 ms at 48 kHz, a divisor of every HCD frame counter period */
+#define ZG01_MIX_MS      128
+#define ZG01_MIX_FRAMES  (ZG01_MIX_MS * 48)
+
+/*
+ * Stream mix loopback: Game and Voice Out (as sent) and Voice In (as
+ * unpacked) are summed in completion context. Every source adds its URB
+ * at the ring position of the bus frame it ran on, so the sources stay
+ * phase-aligned; frames are handed to the capture PCM once every source
+ * has had a chance to add them.
+ */
+struct zg01_mix {
+    spinlock_t lock;
+    struct snd_pcm_substream *substream;
+    bool running;
+    bool synced;            /* 'read' has been placed on the bus timeline */
+    unsigned int read;      /* Next ring frame to deliver */
+    unsigned int pos;       /* Frames delivered to the capture PCM */
+    int volume[ZG01_NUM_CHANNELS];  /* Per source, indexed by CHANNEL_TYPE_* */
+    u32 gain[ZG01_NUM_CHANNELS];
+    s32 buf[ZG01_MIX_FRAMES][2];
+};
+
+/*
+ * Capture pre-roll: with the preroll_ms parameter the Voice In URBs keep
+ * running between captures and the newest frames land here, so a capture
+ * started later begins that far in the past. Under the Voice In dev lock.
+ */
+struct zg01_preroll {
+    s32 (*buf)[2];          /* Allocated when pre-roll is enabled */
+    unsigned int frames;    /* Ring length, a multiple of 6 */
+    unsigned int head;      /* Next frame to write */
+    unsigned int filled;    /* Valid frames behind head */
+    bool pending;           /* Capture started, copy the ring on its first URB */
+};
+
+/* Hardware changes the notification work reads back (bits of zg01_notify.pending) */
+enum {
+    ZG01_NOTIFY_RATE,
+    ZG01_NOTIFY_MUTE,
+    ZG01_NOTIFY_VOLUME,
+    ZG01_NOTIFY_MIC_SELECT,
+    ZG01_NOTIFY_NR
+};
+
+/*
+ * Listener on the interrupt endpoint of interface 2 (0x84 at alt 1). The
+ * device posts UAC2 status messages there for its clock source and its
+ * hardware mute and knob; the URB runs whenever interface 2 sits at that
+ * alt setting. Clock messages wake waiters on 'wait', control messages are
+ * read back by 'work' and raised as ALSA control events.
+ */
+struct zg01_notify {
+    struct urb *urb;            /* NULL if the device has no interrupt endpoint */
+    u8 *buf;
+    int alt;                    /* Alt setting of interface 2 carrying the endpoint */
+
+    wait_queue_head_t wait;
+    unsigned int clock_events;  /* Clock messages received so far (wraps) */
+
+    struct work_struct work;
+    spinlock_t lock;            /* pending and 'control' */
+    unsigned long pending;      /* ZG01_NOTIFY_* */
+    struct { u16 value, index; } control[ZG01_NOTIFY_NR];  /* Unit that posted it */
+};
+
+/* Device controls behind the ALSA mixer */
+enum {
+    ZG01_HWCTL_MUTE,            /* Feature unit mute */
+    ZG01_HWCTL_VOLUME,          /* Feature unit volume (the knob), 1/256 dB */
+    ZG01_HWCTL_MIC_SELECT,      /* Selector unit: 0 = phono input, 1 = mic input */
+    ZG01_HWCTL_NR
+};
+
+/*
+ * Write-behind cache of the device controls. ALSA get/put only touch
+ * 'value'; a put marks the control dirty and the flush work sends every
+ * dirty control in one zg01_ctrl_run() batch, at most once per flush
+ * interval and never in the middle of the magic sequence. The units are
+ * found in the AudioControl descriptors at probe (windex 0 = absent).
+ */
+struct zg01_hwctl {
+    spinlock_t lock;            /* Everything below but 'flush' */
+    int value[ZG01_HWCTL_NR];
+    unsigned long dirty;        /* ZG01_HWCTL_* written but not sent yet */
+    u16 wvalue[ZG01_HWCTL_NR];  /* Control selector << 8 | channel */
+    u16 windex[ZG01_HWCTL_NR];  /* Unit ID << 8 | interface 0 */
+    int vol_min, vol_max, vol_res;  /* Knob range, 1/256 dB, from the RANGE request at bring-up */
+    struct delayed_work flush;
+
+    struct snd_card *card;      /* Card carrying the controls (NULL = none yet) */
+    struct snd_kcontrol *kctl[ZG01_HWCTL_NR];
+};
+
+/* Alt setting state of one streaming interface */
+struct zg01_iface_state {
+    int alt;        /* Alt setting last committed to the device (-1 = unknown) */
+    int users;      /* Open streams that need the interface at alt 1 */
+    int armed;      /* Prepared streams whose URBs may be in flight */
+};
+
+/*
+ * Per-USB-device context shared by the Game, Voice In and Voice Out cards.
+ *
+ * The three cards talk to the same two streaming interfaces and the same
+ * clock source, so every usb_set_interface() and every clock change goes
+ * through here. An interface is never switched while one of its streams is
+ * armed, and the magic sequence (which cycles both interfaces) only runs
+ * when no stream at all is armed.
+ */
+struct zg01_shared {
+    struct kref kref;
+    struct list_head list;
+    struct usb_device *udev;
+
+    struct mutex lock;      /* Serializes alt settings and clock changes */
+    struct zg01_iface_state iface[ZG01_NUM_IFACES];
+
+    unsigned int rate;      /* Clock rate reported by the device (0 = unknown) */
+    bool clock_configured;  /* Magic sequence has completed at 'rate' */
+    unsigned int rates[ZG01_MAX_RATES];     /* Clock source rates (UAC2 RANGE at bring-up) */
+    unsigned int nr_rates;                  /* 0 = not known */
+
+    /* Magic sequence at ZG01_DEFAULT_RATE, run once when the context is created */
+    struct work_struct bringup_work;
+    struct completion bringup_done;
+
+    struct zg01_notify notify;
+    struct zg01_hwctl hwctl;
+
+    struct zg01_dev *devs[ZG01_NUM_CHANNELS]; /* Protected by the probe mutex */
+
+    struct zg01_sidetone sidetone;
+    struct zg01_mix mix;
+    struct zg01_preroll preroll;
+};
+
+/*
+ * One request of a control sequence run by zg01_ctrl_run(). 'data' is the
+ * payload of OUT requests and receives the reply of IN requests (any
+ * memory; the engine bounces it through a DMA-safe buffer).
+ */
+struct zg01_ctrl_step {
+    u8 request_type;        /* bmRequestType; USB_DIR_IN makes it a read */
+    u8 request;
+    u16 value;
+    u16 index;
+    u16 length;
+    u16 timeout_ms;         /* Budget of this step within the sequence */
+    bool independent;       /* A failure here does not stop the steps after it */
+    void *data;
+    int status;             /* Result: bytes transferred or -errno (-ECANCELED: not sent) */
+};
+
+#define ZG01_CTRL_VENDOR_IN(req, val, len) \
+    { .request_type = USB_DIR_IN | USB_TYPE_VENDOR | USB_RECIP_DEVICE, \
+      .request = (req), .value = (val), .length = (len), .timeout_ms = 1000 }
+
+int zg01_ctrl_run(struct usb_device *udev, struct zg01_ctrl_step *steps, unsigned int n);
+
+struct zg01_shared *zg01_shared_get(struct usb_device *udev);
+void zg01_shared_put(struct zg01_shared *sh);
+
+int zg01_shared_iface_get(struct zg01_shared *sh, int iface);
+void zg01_shared_iface_put(struct zg01_shared *sh, int iface);
+int zg01_shared_arm(struct zg01_shared *sh, int iface, bool *armed);
+void zg01_shared_disarm(struct zg01_shared *sh, int iface, bool *armed);
+
+int zg01_shared_set_rate(struct zg01_shared *sh, unsigned int rate, bool self_armed);
+int zg01_shared_read_rate(struct zg01_shared *sh, unsigned int *rate);
+unsigned int zg01_shared_locked_rate(struct zg01_shared *sh, bool self_armed);
+bool zg01_shared_hwctl_present(struct zg01_shared *sh, int id);
+int zg01_shared_hwctl_get(struct zg01_shared *sh, int id);
+int zg01_shared_hwctl_put(struct zg01_shared *sh, int id, int value);
+void zg01_shared_hwctl_range(struct zg01_shared *sh, int *min, int *max, int *res);
+int zg01_shared_suspend(struct zg01_shared *sh, int iface, bool autosuspend);
+int zg01_shared_resume(struct zg01_shared *sh, int iface, bool reset);
+void zg01_shared_hwctl_attach(struct zg01_shared *sh, int id, struct snd_card *card,
+                              struct snd_kcontrol *kctl);
+
+#endif /* ZG01_SHARED_H */
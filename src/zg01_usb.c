@@ -1,5 +1,6 @@
 #include <linux/module.h>
 #include <linux/usb.h>
+#include <linux/version.h>
 #include <linux/slab.h>
 #include <sound/core.h>
 #include <sound/pcm.h>
@@ -15,20 +16,254 @@
 static DEFINE_MUTEX(devices_mutex);
 DECLARE_BITMAP(devices_used, SNDRV_CARDS);
 
-/* Track which cards have been created for this device */
-static struct zg01_dev *game_dev = NULL;
-static struct zg01_dev *voice_in_dev = NULL;
-static struct zg01_dev *voice_out_dev = NULL;
+static bool single_card;
+module_param(single_card, bool, 0444);
+MODULE_PARM_DESC(single_card, "Expose Game, Voice In and Voice Out as PCM devices 0, 1 and 2 of one card");
+
+static bool autosuspend = true;
+module_param(autosuspend, bool, 0444);
+MODULE_PARM_DESC(autosuspend, "Let the device runtime-suspend once no stream is open");
+
+static struct usb_driver zg01_driver;
+
+/* Kill and release the URBs of one channel */
+static void zg01_free_channel_urbs(struct urb **iso_urbs, unsigned char **iso_buffers)
+{
+    int i;
+
+    for (i = 0; i < MAX_URBS_PER_CHANNEL; i++) {
+        if (iso_urbs[i]) {
+            usb_kill_urb(iso_urbs[i]);
+            usb_free_urb(iso_urbs[i]);
+            iso_urbs[i] = NULL;
+        }
+        if (iso_buffers[i]) {
+            iso_buffers[i] = NULL;
+        }
+    }
+}
+
+/* Stop everything of one channel that may still run against its card: works, URBs, MIDI */
+static void zg01_free_dev(struct zg01_dev *dev)
+{
+    zg01_free_pcm(dev);
+    zg01_free_channel_urbs(dev->iso_urbs_game, dev->iso_buffers_game);
+    zg01_free_channel_urbs(dev->iso_urbs_voice, dev->iso_buffers_voice);
+    zg01_free_channel_urbs(dev->iso_urbs_voice_out, dev->iso_buffers_voice_out);
+    zg01_free_control(dev);
+    zg01_free_midi(dev);
+}
+
+/* Undo a partially set up card: drop it from the shared context and free it */
+static void zg01_probe_abort(struct zg01_dev *dev)
+{
+    struct zg01_shared *sh = dev->shared;
+    struct zg01_dev *survivor = NULL;
+    int t;
+
+    mutex_lock(&devices_mutex);
+    if (sh->devs[dev->channel_type] == dev)
+        sh->devs[dev->channel_type] = NULL;
+    /* Keep intfdata pointing at a live card so disconnect still finds the interface */
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++)
+        if (sh->devs[t] && sh->devs[t]->interface == dev->interface)
+            survivor = sh->devs[t];
+    usb_set_intfdata(dev->interface, survivor);
+    mutex_unlock(&devices_mutex);
+
+    zg01_free_dev(dev);
+    snd_card_free(dev->card);  /* This frees the embedded dev structure */
+    zg01_shared_put(sh);
+}
+
+/* Initialize one channel's zg01_dev (the shared context holds the usb_device reference) */
+static void zg01_init_dev(struct zg01_dev *dev, struct snd_card *card, struct zg01_shared *sh,
+                          struct usb_interface *interface, int channel_type, int card_index)
+{
+    dev->card = card;
+    dev->card_index = card_index;
+    dev->channel_type = channel_type;
+    dev->pcm_device = 0;
+
+    dev->shared = sh;
+    dev->udev = sh->udev;
+    dev->interface = interface;
+    spin_lock_init(&dev->lock);
+    dev->link_frame = -1;
+    dev->echo_link_frame = -1;
+    mutex_init(&dev->pcm_mutex);
+    dev->game_channel_active = false;
+    dev->voice_channel_active = false;
+    dev->voice_out_channel_active = false;
+    dev->iface_claimed = false;
+    dev->armed = false;
+    dev->cleanup_in_progress_game = false;
+    dev->cleanup_in_progress_voice = false;
+    dev->cleanup_in_progress_voice_out = false;
+    INIT_DELAYED_WORK(&dev->start_work_game, (void *)0);
+    INIT_DELAYED_WORK(&dev->start_work_voice, (void *)0);
+    INIT_DELAYED_WORK(&dev->start_work_voice_out, (void *)0);
+    INIT_WORK(&dev->preroll_work, (void *)0);
+    dev->start_pending_game = false;
+    dev->start_pending_voice = false;
+    dev->start_pending_voice_out = false;
+}
+
+/* Set distinctive card names based on channel type (-1 = single-card topology) */
+static void zg01_set_card_names(struct snd_card *card, int channel_type)
+{
+    strncpy(card->driver, "zg01_usb", sizeof(card->driver));
+    
+    if (channel_type < 0) {
+        strncpy(card->shortname, "ZG01", sizeof(card->shortname));
+        strncpy(card->longname, "Yamaha ZG01", sizeof(card->longname));
+        strncpy(card->mixername, "ZG01", sizeof(card->mixername));
+        strncpy(card->components, "USB0499:1513", sizeof(card->components));
+    } else if (channel_type == CHANNEL_TYPE_GAME) {
+        strncpy(card->shortname, "ZG01 Game", sizeof(card->shortname));
+        strncpy(card->longname, "Yamaha ZG01 Game Channel", sizeof(card->longname));
+        strncpy(card->mixername, "ZG01 Game", sizeof(card->mixername));
+        strncpy(card->components, "USB0499:1513-Game", sizeof(card->components));
+    } else if (channel_type == CHANNEL_TYPE_VOICE_IN) {
+        strncpy(card->shortname, "ZG01 Voice In", sizeof(card->shortname));
+        strncpy(card->longname, "Yamaha ZG01 Voice Input Channel", sizeof(card->longname));
+        strncpy(card->mixername, "ZG01 Voice In", sizeof(card->mixername));
+        strncpy(card->components, "USB0499:1513-VoiceIn", sizeof(card->components));
+    } else {
+        strncpy(card->shortname, "ZG01 Voice Out", sizeof(card->shortname));
+        strncpy(card->longname, "Yamaha ZG01 Voice Output Channel", sizeof(card->longname));
+        strncpy(card->mixername, "ZG01 Voice Out", sizeof(card->mixername));
+        strncpy(card->components, "USB0499:1513-VoiceOut", sizeof(card->components));
+    }
+}
+
+/*
+ * Single-card topology: one card carrying Game, Voice In and Voice Out as
+ * PCM devices 0, 1 and 2. Whichever streaming interface probes first claims
+ * the other one, so the card is created and registered exactly once.
+ * Called with devices_mutex held and a shared context reference taken.
+ */
+static int zg01_probe_single(struct usb_interface *interface, struct zg01_shared *sh)
+{
+    struct usb_device *udev = interface_to_usbdev(interface);
+    struct usb_interface *ifaces[ZG01_NUM_IFACES] = { NULL };
+    struct usb_interface *other;
+    struct zg01_dev *devs;
+    struct snd_card *card;
+    int iface_num = interface->cur_altsetting->desc.bInterfaceNumber;
+    int t, err;
+
+    if (sh->devs[CHANNEL_TYPE_GAME]) {
+        zg01_shared_put(sh);
+        return 0; /* Already created from the other interface */
+    }
+
+    ifaces[1] = usb_ifnum_to_if(udev, 1);
+    ifaces[2] = usb_ifnum_to_if(udev, 2);
+    if (!ifaces[1] || !ifaces[2]) {
+        dev_err(&interface->dev, "ZG01: Streaming interfaces 1/2 missing\n");
+        zg01_shared_put(sh);
+        return -ENODEV;
+    }
+
+    err = snd_card_new(&interface->dev, -1, "zg01", THIS_MODULE,
+                       ZG01_NUM_CHANNELS * sizeof(struct zg01_dev), &card);
+    if (err) {
+        dev_err(&interface->dev, "Failed to create sound card: %d\n", err);
+        zg01_shared_put(sh);
+        return err;
+    }
+
+    /* One zg01_dev per channel, embedded back to back in the card */
+    devs = card->private_data;
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++) {
+        struct usb_interface *intf = ifaces[t == CHANNEL_TYPE_VOICE_IN ? 2 : 1];
+
+        /* Every dev holds its own shared reference, as in the split topology */
+        if (t > 0)
+            zg01_shared_get(udev);
+        zg01_init_dev(&devs[t], card, sh, intf, t, card->number);
+        devs[t].pcm_device = t;
+        sh->devs[t] = &devs[t];
+    }
+
+    other = ifaces[iface_num == 1 ? 2 : 1];
+    err = usb_driver_claim_interface(&zg01_driver, other,
+                                     &devs[other == ifaces[2] ? CHANNEL_TYPE_VOICE_IN : CHANNEL_TYPE_GAME]);
+    if (err) {
+        dev_err(&interface->dev, "Failed to claim interface %d: %d\n", iface_num == 1 ? 2 : 1, err);
+        goto free_card;
+    }
+    usb_set_intfdata(interface, &devs[iface_num == 2 ? CHANNEL_TYPE_VOICE_IN : CHANNEL_TYPE_GAME]);
+
+    zg01_set_card_names(card, -1);
+
+    if (autosuspend)
+        usb_enable_autosuspend(udev);
+
+    err = zg01_init_control(&devs[CHANNEL_TYPE_GAME]);
+    if (err) {
+        dev_err(&interface->dev, "Failed to initialize control interface: %d\n", err);
+        goto release;
+    }
+
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++) {
+        err = zg01_discover_usb_config(&devs[t]);
+        if (err)
+            pr_warn("zg01_usb: USB discovery failed, continuing anyway: %d\n", err);
+
+        err = zg01_create_pcm(&devs[t]);
+        if (err) {
+            dev_err(&interface->dev, "Failed to create PCM device %d: %d\n", t, err);
+            goto release;
+        }
+
+        err = zg01_create_mixer(&devs[t]);
+        if (err) {
+            dev_err(&interface->dev, "Failed to create mixer controls %d: %d\n", t, err);
+            goto release;
+        }
+    }
+
+    err = zg01_create_midi(&devs[CHANNEL_TYPE_GAME], &zg01_driver);
+    if (err && err != -ENODEV)
+        dev_warn(&interface->dev, "ZG01: MIDI port not created: %d\n", err);
+
+    err = snd_card_register(card);
+    if (err < 0) {
+        dev_err(&interface->dev, "Failed to register sound card: %d\n", err);
+        goto release;
+    }
+
+    dev_info(&interface->dev, "Yamaha ZG01 registered as a single card (Game, Voice In, Voice Out)\n");
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++)
+        zg01_preroll_start(&devs[t]);
+    return 0;
+
+release:
+    usb_set_intfdata(other, NULL);
+    usb_set_intfdata(interface, NULL);
+    usb_driver_release_interface(&zg01_driver, other);
+free_card:
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++) {
+        zg01_free_dev(&devs[t]);
+        sh->devs[t] = NULL;
+    }
+    snd_card_free(card);  /* This frees the embedded dev structures */
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++)
+        zg01_shared_put(sh);
+    return err;
+}
+
+static int zg01_probe_channel(struct usb_interface *interface, struct zg01_shared *sh,
+                              int channel_type);
 
 static int zg01_probe(struct usb_interface *interface,
                       const struct usb_device_id *id)
 {
-    struct zg01_dev *dev;
-    struct snd_card *card;
+    struct zg01_shared *sh;
     int err;
-    unsigned int card_index;
     int iface_num;
-    int channel_type; /* 0=game, 1=voice_in, 2=voice_out */
 
     /* Create sound cards for Game (Interface 1), Voice In (Interface 2), and Voice Out (Interface 1 alt config) */
     iface_num = interface->cur_altsetting->desc.bInterfaceNumber;
@@ -36,33 +271,79 @@ static int zg01_probe(struct usb_interface *interface,
     mutex_lock(&devices_mutex);
     if (iface_num != 1 && iface_num != 2) {
         dev_info(&interface->dev, "ZG01: Skipping interface %d (not Game/Voice)\n", iface_num);
-        mutex_unlock(&devices_mutex); return 0; /* Success but no card created */
+        mutex_unlock(&devices_mutex);
+        /* The MIDI interface is claimed by the Game card's MIDI port, never bound here */
+        return iface_num == 3 ? -ENODEV : 0; /* Success but no card created */
+    }
+
+    /* All cards of one USB device share a context (alt settings, clock) */
+    sh = zg01_shared_get(interface_to_usbdev(interface));
+    if (!sh) {
+        mutex_unlock(&devices_mutex);
+        return -ENOMEM;
+    }
+
+    if (single_card) {
+        err = zg01_probe_single(interface, sh);
+        mutex_unlock(&devices_mutex);
+        return err;
     }
 
     /* Interface 1 creates TWO cards: Game (playback) and Voice Out (playback)
      * Interface 2 creates ONE card: Voice In (capture) */
-    if (iface_num == 1) {
-        /* Create Game playback card first */
-        if (!game_dev) {
-            channel_type = CHANNEL_TYPE_GAME;
-            dev_info(&interface->dev, "Yamaha ZG01 Game channel detected (interface %d)\n", iface_num);
-        } else if (!voice_out_dev) {
-            /* Create Voice Out playback card second */
-            channel_type = CHANNEL_TYPE_VOICE_OUT;
-            dev_info(&interface->dev, "Yamaha ZG01 Voice Out channel detected (interface %d)\n", iface_num);
-        } else {
-            /* Both cards already created for interface 1 */
-            mutex_unlock(&devices_mutex); return 0;
-        }
-    } else {
-        /* Interface 2 - Voice In capture */
-        if (voice_in_dev) {
+    if (iface_num == 2) {
+        if (sh->devs[CHANNEL_TYPE_VOICE_IN]) {
+            zg01_shared_put(sh);
             mutex_unlock(&devices_mutex); return 0; /* Already created */
         }
-        channel_type = CHANNEL_TYPE_VOICE_IN;
         dev_info(&interface->dev, "Yamaha ZG01 Voice In channel detected (interface %d)\n", iface_num);
+        return zg01_probe_channel(interface, sh, CHANNEL_TYPE_VOICE_IN);
+    }
+
+    /* Create Game playback card first */
+    if (!sh->devs[CHANNEL_TYPE_GAME]) {
+        dev_info(&interface->dev, "Yamaha ZG01 Game channel detected (interface %d)\n", iface_num);
+        err = zg01_probe_channel(interface, sh, CHANNEL_TYPE_GAME);
+        if (err)
+            return err;
+
+        /* The Voice Out card holds its own shared context reference */
+        mutex_lock(&devices_mutex);
+        sh = zg01_shared_get(interface_to_usbdev(interface));
+        if (!sh) {
+            mutex_unlock(&devices_mutex);
+            dev_warn(&interface->dev, "ZG01: No memory for the Voice Out card\n");
+            return 0;
+        }
     }
 
+    if (sh->devs[CHANNEL_TYPE_VOICE_OUT]) {
+        /* Both cards already created for interface 1 */
+        zg01_shared_put(sh);
+        mutex_unlock(&devices_mutex); return 0;
+    }
+
+    /* Create Voice Out playback card second; the interface stays bound to Game if it fails */
+    dev_info(&interface->dev, "Yamaha ZG01 Voice Out channel detected (interface %d)\n", iface_num);
+    err = zg01_probe_channel(interface, sh, CHANNEL_TYPE_VOICE_OUT);
+    if (err)
+        dev_warn(&interface->dev, "ZG01: Voice Out card not created: %d\n", err);
+    return 0;
+}
+
+/*
+ * Create and register the card of one channel on @interface. Called with
+ * devices_mutex held and a shared context reference taken for the card;
+ * drops the mutex once the card is tracked in the shared context.
+ */
+static int zg01_probe_channel(struct usb_interface *interface, struct zg01_shared *sh,
+                              int channel_type)
+{
+    struct zg01_dev *dev;
+    struct snd_card *card;
+    unsigned int card_index;
+    int err;
+
     for (card_index = 0; card_index < SNDRV_CARDS; ++card_index)
         if (!test_bit(card_index, devices_used))
             break;
@@ -82,44 +363,17 @@ static int zg01_probe(struct usb_interface *interface,
                        sizeof(struct zg01_dev), &card);
     if (err) {
         dev_err(&interface->dev, "Failed to create sound card: %d\n", err);
+        zg01_shared_put(sh);
+        mutex_unlock(&devices_mutex);
         return err;
     }
 
     /* Use the dev structure embedded in the card - this is critical! */
     dev = card->private_data;
-    dev->card = card;
-    dev->card_index = card_index;
-    dev->channel_type = channel_type;
-    
-    /* Initialize dev structure */
-    dev->udev = usb_get_dev(interface_to_usbdev(interface));
-    dev->interface = interface;
-    spin_lock_init(&dev->lock);
-    mutex_init(&dev->pcm_mutex);
-    dev->game_channel_active = false;
-    dev->voice_channel_active = false;
-    dev->voice_out_channel_active = false;
-    dev->game_initialized = false;
-    dev->voice_initialized = false;
-    dev->voice_out_initialized = false;
-    dev->cleanup_in_progress_game = false;
-    dev->cleanup_in_progress_voice = false;
-    dev->cleanup_in_progress_voice_out = false;
-    INIT_DELAYED_WORK(&dev->start_work_game, (void *)0);
-    INIT_DELAYED_WORK(&dev->start_work_voice, (void *)0);
-    INIT_DELAYED_WORK(&dev->start_work_voice_out, (void *)0);
-    dev->start_pending_game = false;
-    dev->start_pending_voice = false;
-    dev->start_pending_voice_out = false;
+    zg01_init_dev(dev, card, sh, interface, channel_type, card_index);
 
-    /* Track device pointers globally */
-    if (channel_type == CHANNEL_TYPE_GAME) {
-        game_dev = dev;
-    } else if (channel_type == CHANNEL_TYPE_VOICE_IN) {
-        voice_in_dev = dev;
-    } else {
-        voice_out_dev = dev;
-    }
+    /* Track device pointers in the shared context */
+    sh->devs[channel_type] = dev;
 
     /* Unlock mutex - critical section complete */
     mutex_unlock(&devices_mutex);
@@ -127,30 +381,12 @@ static int zg01_probe(struct usb_interface *interface,
 
     snd_card_set_dev(card, &interface->dev);
 
-    strncpy(card->driver, "zg01_usb", sizeof(card->driver));
-    
-    /* Set distinctive card names based on channel type immediately */
-    if (channel_type == CHANNEL_TYPE_GAME) {
-        strncpy(card->shortname, "ZG01 Game", sizeof(card->shortname));
-        strncpy(card->longname, "Yamaha ZG01 Game Channel", sizeof(card->longname));
-        strncpy(card->mixername, "ZG01 Game", sizeof(card->mixername));
-        strncpy(card->components, "USB0499:1513-Game", sizeof(card->components));
-    } else if (channel_type == CHANNEL_TYPE_VOICE_IN) {
-        strncpy(card->shortname, "ZG01 Voice In", sizeof(card->shortname));
-        strncpy(card->longname, "Yamaha ZG01 Voice Input Channel", sizeof(card->longname));
-        strncpy(card->mixername, "ZG01 Voice In", sizeof(card->mixername));
-        strncpy(card->components, "USB0499:1513-VoiceIn", sizeof(card->components));
-    } else {
-        strncpy(card->shortname, "ZG01 Voice Out", sizeof(card->shortname));
-        strncpy(card->longname, "Yamaha ZG01 Voice Output Channel", sizeof(card->longname));
-        strncpy(card->mixername, "ZG01 Voice Out", sizeof(card->mixername));
-        strncpy(card->components, "USB0499:1513-VoiceOut", sizeof(card->components));
-    }
+    zg01_set_card_names(card, channel_type);
 
     err = zg01_init_control(dev);
     if (err) {
         dev_err(&interface->dev, "Failed to initialize control interface: %d\n", err);
-        snd_card_free(card);
+        zg01_probe_abort(dev);
         return err;
     }    
 
@@ -160,36 +396,40 @@ static int zg01_probe(struct usb_interface *interface,
         pr_warn("zg01_usb: USB discovery failed, continuing anyway: %d\n", err);
     }
 
-    /* Set interface alternate settings for audio streaming */
-    err = usb_set_interface(dev->udev, 1, 0);
-    if (err) {
-        dev_err(&interface->dev, "Failed to set interface 1 alt 0: %d\n", err);
-    }
-    
-    err = usb_set_interface(dev->udev, 2, 0);  
-    if (err) {
-        dev_err(&interface->dev, "Failed to set interface 2 alt 0: %d\n", err);
-    }
+    /* Alt settings and clock are left to the shared context's bring-up work */
+
+    if (autosuspend)
+        usb_enable_autosuspend(interface_to_usbdev(interface));
 
     err = zg01_create_pcm(dev);
     if (err) {
         dev_err(&interface->dev, "Failed to create PCM device: %d\n", err);
-        snd_card_free(card);
+        zg01_probe_abort(dev);
+        return err;
+    }
+
+    err = zg01_create_mixer(dev);
+    if (err) {
+        dev_err(&interface->dev, "Failed to create mixer controls: %d\n", err);
+        zg01_probe_abort(dev);
         return err;
     }
 
+    /* MIDI lives on the Game card; audio works without it */
+    if (channel_type == CHANNEL_TYPE_GAME) {
+        err = zg01_create_midi(dev, &zg01_driver);
+        if (err && err != -ENODEV)
+            dev_warn(&interface->dev, "ZG01: MIDI port not created: %d\n", err);
+    }
+
     err = snd_card_register(card);
     if (err < 0) {
         dev_err(&interface->dev, "Failed to register sound card: %d\n", err);
-        snd_card_free(card);  /* This frees the embedded dev structure */
+        zg01_probe_abort(dev);
         return err;
     }
 
-    /* For interface 1, probe again to create the voice output card */
-    if (iface_num == 1 && channel_type == CHANNEL_TYPE_GAME) {
-        dev_info(&interface->dev, "ZG01: Probing interface 1 again for voice output\n");
-        return zg01_probe(interface, id);
-    }
+    zg01_preroll_start(dev);
 
     return 0;
 }
@@ -197,73 +437,127 @@ static int zg01_probe(struct usb_interface *interface,
 static void zg01_disconnect(struct usb_interface *interface)
 {
     struct zg01_dev *dev = usb_get_intfdata(interface);
-    int iface_num = interface->cur_altsetting->desc.bInterfaceNumber;
+    struct zg01_shared *sh;
+    int t;
 
     usb_set_intfdata(interface, NULL);
 
     if (!dev)
         return;
 
-    /* Clean up all channels for this interface */
-    int i;
-    
-    /* Clean up Game channel URBs */
-    if (dev->channel_type == CHANNEL_TYPE_GAME || iface_num == 1) {
-        for (i = 0; i < MAX_URBS_PER_CHANNEL; i++) {
-            if (dev->iso_urbs_game[i]) {
-                usb_kill_urb(dev->iso_urbs_game[i]);
-                usb_free_urb(dev->iso_urbs_game[i]);
-                dev->iso_urbs_game[i] = NULL;
-            }
-            if (dev->iso_buffers_game[i]) {
-                dev->iso_buffers_game[i] = NULL;
-            }
-        }
-    }
-    
-    /* Clean up Voice In channel URBs */
-    if (dev->channel_type == CHANNEL_TYPE_VOICE_IN || iface_num == 2) {
-        for (i = 0; i < MAX_URBS_PER_CHANNEL; i++) {
-            if (dev->iso_urbs_voice[i]) {
-                usb_kill_urb(dev->iso_urbs_voice[i]);
-                usb_free_urb(dev->iso_urbs_voice[i]);
-                dev->iso_urbs_voice[i] = NULL;
-            }
-            if (dev->iso_buffers_voice[i]) {
-                dev->iso_buffers_voice[i] = NULL;
-            }
-        }
-    }
-    
-    /* Clean up Voice Out channel URBs */
-    if (dev->channel_type == CHANNEL_TYPE_VOICE_OUT || iface_num == 1) {
-        for (i = 0; i < MAX_URBS_PER_CHANNEL; i++) {
-            if (dev->iso_urbs_voice_out[i]) {
-                usb_kill_urb(dev->iso_urbs_voice_out[i]);
-                usb_free_urb(dev->iso_urbs_voice_out[i]);
-                dev->iso_urbs_voice_out[i] = NULL;
-            }
-            if (dev->iso_buffers_voice_out[i]) {
-                dev->iso_buffers_voice_out[i] = NULL;
-            }
+    sh = dev->shared;
+
+    /* Interface 1 carries both the Game and the Voice Out card, and intfdata
+     * only points at the last one probed: tear down every card on this interface.
+     * In the single-card topology that card also carries the other interface's
+     * PCM, so every dev on the card goes with it. */
+    mutex_lock(&devices_mutex);
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++) {
+        struct zg01_dev *d = sh->devs[t];
+        struct snd_card *card;
+        int u, refs = 0;
+
+        if (!d || d->interface != interface)
+            continue;
+
+        card = d->card;
+        for (u = 0; u < ZG01_NUM_CHANNELS; u++) {
+            struct zg01_dev *c = sh->devs[u];
+
+            if (!c || c->card != card)
+                continue;
+
+            zg01_free_dev(c);
+
+            if (c->interface != interface)
+                usb_set_intfdata(c->interface, NULL);
+            sh->devs[u] = NULL;
+            refs++;
         }
+
+        /* Free the card - this will also free the embedded dev structure(s) */
+        snd_card_free(card);
+        while (refs--)
+            zg01_shared_put(sh);
     }
+    mutex_unlock(&devices_mutex);
+
+    dev_info(&interface->dev, "Yamaha ZG01 device disconnected\n");
+}
+
+/*
+ * Suspend every channel carried by @interface. The shared context stops
+ * the notification listener and may refuse an autosuspend while control
+ * writes are still queued; open streams hold a PM reference, so only a
+ * system suspend finds streams to stop here.
+ */
+static int zg01_suspend(struct usb_interface *interface, pm_message_t message)
+{
+    struct zg01_dev *dev = usb_get_intfdata(interface);
+    int iface_num = interface->cur_altsetting->desc.bInterfaceNumber;
+    struct zg01_shared *sh;
+    int t, err;
 
-    /* Clear global device pointers */
-    if (dev == game_dev) {
-        game_dev = NULL;
-    } else if (dev == voice_in_dev) {
-        voice_in_dev = NULL;
-    } else if (dev == voice_out_dev) {
-        voice_out_dev = NULL;
+    if (!dev)
+        return 0;
+    sh = dev->shared;
+
+    err = zg01_shared_suspend(sh, iface_num, PMSG_IS_AUTO(message));
+    if (err)
+        return err;
+
+    mutex_lock(&devices_mutex);
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++) {
+        struct zg01_dev *d = sh->devs[t];
+
+        if (!d || d->interface != interface)
+            continue;
+        if (!PMSG_IS_AUTO(message))
+            snd_power_change_state(d->card, SNDRV_CTL_POWER_D3hot);
+        zg01_pcm_suspend(d);
+        zg01_midi_suspend(d);
     }
+    mutex_unlock(&devices_mutex);
+    return 0;
+}
+
+static int zg01_resume_common(struct usb_interface *interface, bool reset)
+{
+    struct zg01_dev *dev = usb_get_intfdata(interface);
+    int iface_num = interface->cur_altsetting->desc.bInterfaceNumber;
+    struct zg01_shared *sh;
+    int t, err;
+
+    if (!dev)
+        return 0;
+    sh = dev->shared;
+
+    /* A listener that did not restart is reported once the channels are back */
+    err = zg01_shared_resume(sh, iface_num, reset);
 
-    /* Free the card - this will also free the embedded dev structure */
-    if (dev->card) {
-        snd_card_free(dev->card);
+    mutex_lock(&devices_mutex);
+    for (t = 0; t < ZG01_NUM_CHANNELS; t++) {
+        struct zg01_dev *d = sh->devs[t];
+
+        if (!d || d->interface != interface)
+            continue;
+        zg01_pcm_resume(d);
+        zg01_midi_resume(d);
+        snd_power_change_state(d->card, SNDRV_CTL_POWER_D0);
     }
+    mutex_unlock(&devices_mutex);
+    return err;
+}
 
-    dev_info(&interface->dev, "Yamaha ZG01 device disconnected\n");
+static int zg01_resume(struct usb_interface *interface)
+{
+    return zg01_resume_common(interface, false);
+}
+
+/* The device was reset across the suspend and lost its clock and alt setting */
+static int zg01_reset_resume(struct usb_interface *interface)
+{
+    return zg01_resume_common(interface, true);
 }
 
 int zg01_set_streaming_interface(struct zg01_dev *dev, int interface, int alt_setting)
@@ -296,9 +590,38 @@ static struct usb_driver zg01_driver = {
     .id_table = zg01_table,
     .probe = zg01_probe,
     .disconnect = zg01_disconnect,
+    .suspend = zg01_suspend,
+    .resume = zg01_resume,
+    .reset_resume = zg01_reset_resume,
+    .supports_autosuspend = 1,
 };
 
-module_usb_driver(zg01_driver);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+#define ZG01_PROBE_TYPE(drv) ((drv).driver.probe_type)
+#else
+#define ZG01_PROBE_TYPE(drv) ((drv).drvwrap.driver.probe_type)
+#endif
+
+static int __init zg01_init(void)
+{
+    /*
+     * Probe only registers cards; don't hold up the hub thread for other
+     * devices. The single card claims the sibling streaming interface from
+     * the first probe, which needs interfaces 1 and 2 probed one after the
+     * other, so that topology keeps the default (synchronous) probe.
+     */
+    if (!single_card)
+        ZG01_PROBE_TYPE(zg01_driver) = PROBE_PREFER_ASYNCHRONOUS;
+    return usb_register(&zg01_driver);
+}
+
+static void __exit zg01_exit(void)
+{
+    usb_deregister(&zg01_driver);
+}
+
+module_init(zg01_init);
+module_exit(zg01_exit);
 
 MODULE_AUTHOR("Your Name");
 MODULE_DESCRIPTION("Yamaha ZG01 USB Audio Driver");